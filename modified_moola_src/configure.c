@@ -49,12 +49,15 @@ extern	int32_t		(*trace_read)(int16_t, memref *);
 
 void configure_ivybridge(void);
 
+int32_t grow_in_files(void);
+
 int16_t read_cfgfile(FILE *fptr, int16_t tkn, char *fnam);
 
 char		*nxt_str;		//	start of next local argument string
 char		strings[4000];	//	should be enough space for all option/value strings;
 char		*tokens[500];	//	pointers for up to 500 tokens (250 option/value pairs)
 int16_t		tkn_cnt;		//	count of tokens in tokens
+int16_t		in_filmax;		//	number of input files the per-file tables can hold
 
 
 //	TBD:  determine all configure return codes and document them
@@ -90,6 +93,7 @@ int32_t	configure(int argc, char * argv[]) {
 		"-{c}_arch      string      cache architecture: blocking | hum | distr  (blocking)"
 		"-{c}_assoc     int         associativity of {c}\n"
 		"-{c}_lnsize    int         size of a {c} cache line in bytes\n"
+		"-{c}_mapping   int         set index mapping scheme for {c}, 0-9 (see -scheme)\n"
 		"-{c}_coherent  string      coherency protocol for {c} {none | MESI | MOSI} (none)\n"
 		"-{c}_pref      string      prefetch policy for {c} {none | always | miss ...}\n"
 		"-{c}_replace   string      line replacement policy for {c} {LRU | FIFO | RAND}\n"
@@ -102,8 +106,12 @@ int32_t	configure(int argc, char * argv[]) {
 		"-multicore     string      file name of multicore trace file\n"
 		"-output_sets               output set statistics\n"
 		"-preset        string      select a preset cache configuration {IvyBridge ...}\n"
+		"-read_ahead                decompress and parse trace files in separate threads\n"
 		"-run_name      string      use string as the name for this moola run, default: 'moola_PID'\n"
+		"-schemes       int_list    evaluate the leakage of each set mapping scheme in the list in one run\n"
 		"-snapshot      int         generate snap shot output every int instructions\n"
+		"-tags_only                 simulate tags and line status only, no byte usage statistics\n"
+		"-trace_cache               reuse decoded trace files cached in '<trace file>.mcache'\n"
 		"-unicore       string int_list int  unicore trace file name applied to pn1,pn2,pn3 with int delay\n";
 	char		*access_hlp =
 		"The  '-C_access int'  option specifies the access time for the `C' cache, where `C' is one\n"
@@ -186,8 +194,11 @@ int32_t	configure(int argc, char * argv[]) {
 		"The  '-informat string'  option specifies the format of the trace records input file.  The\n"
 		"default value is the standard Moola input format from a gzipped trace file, which is specified\n"
 		"as `moola_gz'.  The complete list of supported formats is:  `dinero_d', `dinero_dgz', `dinero_D',\n"
-		"`dinero_Dgz', `dinero_value', `dinero_valuegz', 'gleipnir', `moola', `moola_gz', `moola_value',\n"
-		"`moola_valuegz', `pin', `pin_gz'.  See the documentation for details of these formats.\n"
+		"`dinero_Dgz', `dinero_value', `dinero_valuegz', 'gleipnir', `moola', `moola_bin', `moola_blk',\n"
+		"`moola_gz', `moola_value', `moola_valuegz', `pin', `pin_gz'.  See the documentation for details\n"
+		"of these formats.  The `moola_bin' format is a fixed-width binary image of the trace records that\n"
+		"is memory mapped and read without any text parsing.  The `moola_blk' format is the compact\n"
+		"block-indexed binary format written by the moola_conv converter from any of the other formats.\n"
 		"Currently, only the 'moola' and 'gleipnir' formats support multi-core trace-files; the other\n"
 		"formats can be used with the -unicore option.  The 'gleipnir' formats require compiling Moola\n"
 		"with the GLEIPNIR flag defined.  The '_value' formats equire compiling Moola with the DATAVALS\n"
@@ -214,6 +225,13 @@ int32_t	configure(int argc, char * argv[]) {
 		"is a decimal number of bytes and should be a power of 2.  If can be specified as a hexadecimal\n"
 		"number by prefixing the number with '0x', a leading 0 will indicate an octal number.  The default\n"
 		"value is 64.\n";
+	char		*mapping_hlp =
+		"The  '-C_mapping int'  option selects the set index mapping scheme of the cache C.  The int\n"
+		"value uses the scheme numbers of '-scheme': 0 modulo, 1 rotate right by 3, 2 tag XOR set,\n"
+		"3 rotate right by 1 and XOR tag, 4 squared tag XOR set, 5 odd multiplier, 6 Intel slice hash,\n"
+		"7 DES, 8 CEASER, 9 tag permutation XOR set.  The default is the '-scheme' value for the data\n"
+		"caches of the '-cache_test' level and 0 (modulo) for every other cache.  Scheme 7 is only\n"
+		"accepted for the data caches of the '-cache_test' level, the only caches cleaned on a key change.\n";
 	char        *memtrace_hlp =
 		"The  '-memtrace string'  option specifies that a trace of memory accesses will be placed into the\n"
 	    "file named 'string'.  The format is time: access_type address size.\n";
@@ -236,9 +254,25 @@ int32_t	configure(int argc, char * argv[]) {
 		"default for the '-preset' option.  The specified preset cache can be modified by providing options\n"
 		"after the -preset option.  For example, the sequence '-preset IvyBridge4c8m -l3_size 16M' will\n"
 		"configure an IvyBridge 4 core system with a 16 megabyte L3 cache rather than the normal 8 MB.\n";
+	char		*read_ahead_hlp =
+		"The  '-read_ahead'  option starts a thread for each input trace file that decompresses and\n"
+		"parses the trace records into batches ahead of the simulation.  The batches are handed to the\n"
+		"main simulation thread through a lock-free ring, so trace decoding and cache simulation run\n"
+		"concurrently on two cores.  The results are identical to a run without '-read_ahead'.\n"
+		"Runs with more than one '-unicore' file always parse each file in its own thread.\n";
 	char		*replace_hlp =
 		"The '-C_replace string' option specifies the cache line replacement policy for cache 'C'.  The\n"
 		"allowed values of string are 'LRU', 'FIFO', or 'RANDOM'.  The default value is 'LRU'.\n";
+	char		*schemes_hlp =
+		"The  '-schemes int_list'  option evaluates several set mapping schemes (see '-scheme') in one pass\n"
+		"over the trace.  The int_list is a comma separated list of distinct scheme numbers 0-9 without\n"
+		"spaces.  The caches are simulated with the first scheme of the list, as if it had been given with\n"
+		"'-scheme'.  Every scheme of the list gets its own set mapping and leakage statistics fed with the\n"
+		"line addresses seen by the data caches of the '-cache_test' level, and writes its own files\n"
+		"'Results_average_{name}_s{scheme}.csv' and 'Results_by_set_{name}_s{scheme}.csv', where {name}\n"
+		"is the '-csvfile2' name.  The other schemes are evaluated by worker threads.  Because only the\n"
+		"first scheme drives the simulation, the address stream of the other schemes is the one produced\n"
+		"by the first scheme's cache behavior.\n";
 	char		*run_name_hlp =
 		"The  '-run_name string'  option simply uses the 'string' value as a name for the Moola run.  If\n"
 		"it is not specified, the default run_name is 'moola_PID', where PID is the numerical process ID\n"
@@ -265,6 +299,19 @@ int32_t	configure(int argc, char * argv[]) {
 		"The  '-snapshot int'  option specifies that snapshot data will be output after every 'int'\n"
 		"instructions.  'int' can be specified in octal (leading 0 digit), in decimal (leading 1-9 digit)\n"
 		"or hexadecimal (leading 0x prefix).  The default value is 0 which turns snap shots off.\n";
+	char		*tags_only_hlp =
+		"The  '-tags_only'  option simulates only the tags and the status of the cache lines.  The data,\n"
+		"original data, and byte status arrays of the lines are not allocated and the byte, element,\n"
+		"sub-block, and block usage counters (Read, Untouch, Live, Useless, Dusty, Dead, Mixed) are not\n"
+		"collected.  The hit, miss, timing, and leakage results are identical to a run without it, with\n"
+		"about a quarter of the cache memory for 64 byte lines.  There is no argument to the option.\n";
+	char		*trace_cache_hlp =
+		"The  '-trace_cache'  option keeps a decoded binary copy of each text trace file in a sidecar file\n"
+		"named '<trace file>.mcache'.  The first run writes the sidecar while it simulates and later runs\n"
+		"read the sidecar in place of decompressing and parsing the trace file.  A sidecar is only used\n"
+		"when the size, modification time, and a hash of the trace file and the '-informat' all match\n"
+		"the run that wrote it.  The 'moola' and 'pin' formats, with or without '_gz' or '_value', can be\n"
+		"cached.  The results are identical to a run without '-trace_cache'.\n";
 	char		*unicore_hlp =
 		"The  '-unicore string int_list int int' option specifies a unicore trace file as the input for this\n"
 		"cache simulation.  The 'string' argument is the trace record file name.  The 'int_list' argument\n"
@@ -330,8 +377,11 @@ int32_t	configure(int argc, char * argv[]) {
 	multiexpand = -1;			//	establish as uninitialized
 	nmbr_cores = 0;
 	output_sets = 0;
+	read_ahead = 0;
 	snapshot = 0;
 	strict_order = 0;
+	tags_only = 0;
+	trace_cache = 0;
 	
 	
 	//  set cache defaults
@@ -340,6 +390,11 @@ int32_t	configure(int argc, char * argv[]) {
 	l2_cfg.shared  = 'P';
 	l3_cfg.shared  = 'S';
 	mem_cfg.shared = 'S';
+	l1d_cfg.mapping = -1;
+	l1i_cfg.mapping = -1;
+	l2_cfg.mapping  = -1;
+	l3_cfg.mapping  = -1;
+	mem_cfg.mapping = -1;
 	
 	tkn_cnt = 0;
 	cfg_error = 0;
@@ -496,6 +551,16 @@ int32_t	configure(int argc, char * argv[]) {
 				trace_open  = trace_open_moola_gz;
 				trace_read  = trace_read_moola_gz;
 				trace_reopen  = trace_reopen_moola_gz;
+			} else if (strcmp(valptr, "moola_bin") == 0) {
+				trace_close = trace_close_moola_bin;
+				trace_open  = trace_open_moola_bin;
+				trace_read  = trace_read_moola_bin;
+				trace_reopen  = trace_reopen_moola_bin;
+			} else if (strcmp(valptr, "moola_blk") == 0) {
+				trace_close = trace_close_moola_blk;
+				trace_open  = trace_open_moola_blk;
+				trace_read  = trace_read_moola_blk;
+				trace_reopen  = trace_reopen_moola_blk;
 			} else if (strcmp(valptr, "moola_value") == 0) {
 				trace_close = trace_close_moola_txt;
 				trace_open  = trace_open_moola_txt;
@@ -596,6 +661,13 @@ int32_t	configure(int argc, char * argv[]) {
 				cfg_error = 1;
 				printf("%s\n", lnsize_hlp);
 			}
+		} else if (strcmp(tknbase, "mapping") == 0) {
+			cash_cfg->mapping = strtol(valptr, NULL, 0);
+			if (cash_cfg->mapping < 0  ||  cash_cfg->mapping > 9) {
+				printf("Configuration error:  %s value of %d is not a mapping scheme\n", tknptr, cash_cfg->mapping);
+				cfg_error = 1;
+				printf("%s\n", mapping_hlp);
+			}
 		} else if (strcmp(tknbase, "-memtrace") == 0) {
 			memtracefil = fopen(valptr, "w");
 			if (memtracefil == NULL) {
@@ -605,13 +677,15 @@ int32_t	configure(int argc, char * argv[]) {
 				printf("%s\n", memtrace_hlp);
 			}
 		} else if (strcmp(tknbase, "-multicore") == 0) {
-			in_fnames[0] = valptr;
 			if (in_filcnt != 0) {
 				printf("Configuration error:  only 1 %s can be specified and cannot be mixed with -unicore\n",
 					   tknptr);
 				cfg_error = 1;
 				printf("%s\n", multicore_hlp);
+			} else if (grow_in_files() == 0) {
+				return -1;
 			}
+			in_fnames[0] = valptr;
 			in_filcnt = 1;
 			multiexpand = 0;
 		} else if (strcmp(tknbase, "-output_sets") == 0) {
@@ -639,6 +713,9 @@ int32_t	configure(int argc, char * argv[]) {
 				cfg_error = 1;
 				printf("%s\n", preset_hlp);
 			}
+		} else if (strcmp(tknbase, "-read_ahead") == 0) {
+			read_ahead = 1;
+			token--;									//	no value for this option, restore token index
 		} else if (strcmp(tknbase, "replace") == 0) {
 			if (strcmp(valptr, "LRU") == 0) {
 				cash_cfg->pref_pol = 'L';
@@ -684,7 +761,16 @@ int32_t	configure(int argc, char * argv[]) {
 			}
 		} else if (strcmp(tknbase, "-snapshot") == 0) {
 			snapshot = strtol(valptr, NULL, 0);
+		} else if (strcmp(tknbase, "-tags_only") == 0) {
+			tags_only = 1;
+			token--;									//	no value for this option, restore token index
+		} else if (strcmp(tknbase, "-trace_cache") == 0) {
+			trace_cache = 1;
+			token--;									//	no value for this option, restore token index
 		} else if (strcmp(tknbase, "-unicore") == 0) {
+			if (grow_in_files() == 0) {
+				return -1;
+			}
 			in_fnames[in_filcnt] = valptr;
 			if (multiexpand == 0) {
 				printf("Configuration error:  -unicore cannot be mixed with -multicore\n");
@@ -729,6 +815,27 @@ int32_t	configure(int argc, char * argv[]) {
 
 		} else if (strcmp(tknbase, "-scheme") == 0) {  // Scheme for the cache
                         scheme = strtol(valptr, NULL, 0);
+
+		} else if (strcmp(tknbase, "-schemes") == 0) {  // Schemes evaluated in one run
+			val = valptr;
+			for (nmbr_schemes = 0; nmbr_schemes < SCHEMES; ) {
+				schemes[nmbr_schemes] = strtol(valptr, &comma, 0);
+				for (p = 0; p < nmbr_schemes  &&  schemes[p] != schemes[nmbr_schemes]; p++) {
+				}
+				if (comma == valptr  ||  (*comma != ','  &&  *comma != '\0')  ||  p < nmbr_schemes
+					||  schemes[nmbr_schemes] < 0  ||  schemes[nmbr_schemes] >= SCHEMES) {
+					printf("Configuration error:  '%s' is not a list of distinct schemes for %s\n", val, tknptr);
+					cfg_error = 1;
+					printf("%s\n", schemes_hlp);
+					break;
+				}
+				nmbr_schemes++;
+				if (*comma != ',') {
+					break;
+				}
+				valptr = comma + 1;
+			}
+			scheme = schemes[0];
 		
 		 } else if (strcmp(tknbase, "-cache_test") == 0) { // Level o cache to study
                         cache_test = strtol(valptr, NULL, 0);
@@ -840,6 +947,10 @@ int32_t	configure(int argc, char * argv[]) {
 					printf("%s\n", lnsize_hlp);
 					help_prnt = 1;					//	help option match was found
 				}
+				if (all_help  ||  strcmp(valptr, "mapping") == 0) {
+					printf("%s\n", mapping_hlp);
+					help_prnt = 1;					//	help option match was found
+				}
 				if (all_help  ||  strcmp(valptr, "memtrace") == 0) {
 					printf("%s\n", memtrace_hlp);
 					help_prnt = 1;					//	help option match was found
@@ -860,6 +971,10 @@ int32_t	configure(int argc, char * argv[]) {
 					printf("%s\n", preset_hlp);
 					help_prnt = 1;					//	help option match was found
 				}
+				if (all_help  ||  strcmp(valptr, "read_ahead") == 0) {
+					printf("%s\n", read_ahead_hlp);
+					help_prnt = 1;					//	help option match was found
+				}
 				if (all_help  ||  strcmp(valptr, "replace") == 0) {
 					printf("%s\n", replace_hlp);
 					help_prnt = 1;					//	help option match was found
@@ -868,6 +983,10 @@ int32_t	configure(int argc, char * argv[]) {
 					printf("%s\n", run_name_hlp);
 					help_prnt = 1;					//	help option match was found
 				}
+				if (all_help  ||  strcmp(valptr, "schemes") == 0) {
+					printf("%s\n", schemes_hlp);
+					help_prnt = 1;					//	help option match was found
+				}
 				if (all_help  ||  strcmp(valptr, "sbsize") == 0) {
 					printf("%s\n", sbsize_hlp);
 					help_prnt = 1;					//	help option match was found
@@ -884,6 +1003,14 @@ int32_t	configure(int argc, char * argv[]) {
 					printf("%s\n", snapshot_hlp);
 					help_prnt = 1;					//	help option match was found
 				}
+				if (all_help  ||  strcmp(valptr, "tags_only") == 0) {
+					printf("%s\n", tags_only_hlp);
+					help_prnt = 1;					//	help option match was found
+				}
+				if (all_help  ||  strcmp(valptr, "trace_cache") == 0) {
+					printf("%s\n", trace_cache_hlp);
+					help_prnt = 1;					//	help option match was found
+				}
 				if (all_help  ||  strcmp(valptr, "unicore") == 0) {
 					printf("%s\n", unicore_hlp);
 					help_prnt = 1;					//	help option match was found
@@ -912,6 +1039,33 @@ int32_t	configure(int argc, char * argv[]) {
 		printf("%s\n", unicore_hlp);
 		return -1;
 	}
+
+	//	a DES key change only cleans the -cache_test cache, any other cache mapped with DES would
+	//	keep its lines in the sets of the old key, so mapping 7 is limited to the -cache_test cache
+	if (l1i_cfg.mapping == 7
+	||  (l1d_cfg.mapping == 7  &&  cache_test != 1)
+	||  (l2_cfg.mapping == 7  &&  cache_test != 2)
+	||  (l3_cfg.mapping == 7  &&  cache_test != 3)
+	||  (mem_cfg.mapping == 7  &&  cache_test != 4)) {
+		printf("ERROR: mapping 7 (DES) can only be used for the data caches of the '-cache_test' level\n");
+		printf("%s\n", mapping_hlp);
+		return -1;
+	}
+
+	//	select the text field decoders for this processor
+	trace_scan_init();
+	
+	//	wrap the selected trace access functions with the sidecar cache versions, this is done
+	//	before the read-ahead wrapping so the cache is read and written by the parse threads
+	if (trace_cache) {
+		trace_cache_init();
+	}
+	
+	//	wrap the selected trace access functions with the read-ahead thread versions, a multi-file
+	//	'-unicore' run always does this so that each file is parsed by its own thread
+	if (read_ahead  ||  (multiexpand == 1  &&  in_filcnt > 1)) {
+		trace_thread_init();
+	}
 	
 	
 	//	Print the final configuration data into a file and to stdout
@@ -1003,6 +1157,9 @@ int32_t	initialize() {
 	int8_t		pndx;		//	index for loop of processors
 	int32_t		stat;		//	status from function calls
 	
+	//	select the tag compare used by search() for this processor
+	search_init();
+	
 	//	Initialize the Level 1 Data Caches
 	for (pndx = 0; pndx < nmbr_cores; pndx++) {
 		sprintf(l1d[pndx].name, "L1D[%d]", pndx);
@@ -1012,8 +1169,8 @@ int32_t	initialize() {
 		} else {
 			l1d[pndx].lower = &l2[0];
 		}
-		stat = init_cache(&l1d[pndx], &l1d_cfg);
 		l1d[pndx].ins_or_data = 1;
+		stat = init_cache(&l1d[pndx], &l1d_cfg);
 		if (stat) {
 			return stat;
 		}
@@ -1028,8 +1185,8 @@ int32_t	initialize() {
 		} else {
 			l1i[pndx].lower = &l2[0];
 		}
-		stat = init_cache(&l1i[pndx], &l1i_cfg);
 		l1i[pndx].ins_or_data = 0;
+		stat = init_cache(&l1i[pndx], &l1i_cfg);
 		if (stat) {
 			return stat;
 		}
@@ -1041,8 +1198,8 @@ int32_t	initialize() {
 			sprintf(l2[pndx].name, "L2[%d]", pndx);
 			l2[pndx].level = 2;
 			l2[pndx].lower = &l3;
-			stat = init_cache(&l2[pndx], &l2_cfg);
 			l2[pndx].ins_or_data = 1;
+			stat = init_cache(&l2[pndx], &l2_cfg);
 			if (stat) {
 				return stat;
 			}
@@ -1051,8 +1208,8 @@ int32_t	initialize() {
 		sprintf(l2[0].name, "L2");
 		l2[0].level = 2;
 		l2[0].lower = &l3;
-		stat = init_cache(&l2[0], &l2_cfg);
 		l2[0].ins_or_data = 1;
+		stat = init_cache(&l2[0], &l2_cfg);
 		if (stat) {
 			return stat;
 		}
@@ -1062,8 +1219,8 @@ int32_t	initialize() {
 	sprintf(l3.name, "L3");
 	l3.level = 3;
 	l3.lower = &mem;
-	stat = init_cache(&l3, &l3_cfg);
 	l3.ins_or_data = 1;
+	stat = init_cache(&l3, &l3_cfg);
 	if (stat) {
 		return stat;
 	}
@@ -1072,8 +1229,8 @@ int32_t	initialize() {
 	sprintf(mem.name, "MEM");
 	mem.level = 4;								//	TBD:  always 4? what if no L3
 	mem.lower = NULL;
+	mem.ins_or_data = 1;
 	stat = init_cache(&mem, &mem_cfg);
-        mem.ins_or_data = 1;
 	if (stat) {
 		return stat;
 	}
@@ -1093,6 +1250,10 @@ int32_t	init_cache(cache *cash, cache_cfg *ccfg) {
 	cacheline	*lptr;		//	line pointer into lines array
 	cacheset	*sets;		//	pointer for the sets of the cache
 	int32_t		sndx;		//	index for loop of sets of a cache
+	int64_t		*tags;		//	storage for the tag arrays of the sets
+	int64_t		tndx;		//	index for loop of tag array entries
+	uint16_t	*ranks;		//	storage for the rank arrays of the sets
+	int64_t		rndx;		//	index for loop of rank array entries
 
 	//	setup configuration pointer, compute number of lines and sets, verify cache size
 	cash->config = ccfg;
@@ -1118,8 +1279,12 @@ int32_t	init_cache(cache *cash, cache_cfg *ccfg) {
 				(int64_t) cash->nmbr_lines * (int64_t) sizeof(cacheline), cash->name);
 		return -1;
 	}
-	data = calloc(cash->nmbr_lines, 3 * ccfg->lin_siz);
-	if (data == NULL) {
+	//	-tags_only keeps no line data, so the lines get NULL data/orig/stat pointers
+	data = NULL;
+	if (!tags_only) {
+		data = calloc(cash->nmbr_lines, 3 * ccfg->lin_siz);
+	}
+	if (data == NULL  &&  !tags_only) {
 		fprintf(stderr, "ERROR, could not get %lld bytes of memory for data/orig/stat of %s cache.\n",
 				(int64_t) cash->nmbr_lines * 3 * (int64_t) ccfg->lin_siz, cash->name);
 		return -2;
@@ -1136,34 +1301,53 @@ int32_t	init_cache(cache *cash, cache_cfg *ccfg) {
 	}
 	cash->sets = sets;		//	link the cache to the sets
 	
+	//	Get the space for the tag arrays, each set has assoc tags rounded up to a multiple of 4
+	//	so that search() can compare 4 ways at a time.  All tags start as not valid.
+	cash->tag_ways = (ccfg->assoc + 3) & ~3;
+	tags = aligned_alloc(64, ((int64_t) cash->nmbr_sets * cash->tag_ways * sizeof(int64_t) + 63) & ~63);
+	if (tags == NULL) {
+		fprintf(stderr, "ERROR, could not get %lld bytes of memory for tags of %s cache.\n",
+				(long long) cash->nmbr_sets * cash->tag_ways * (long long) sizeof(int64_t), cash->name);
+		return -4;
+	}
+	for (tndx = 0; tndx < (int64_t) cash->nmbr_sets * cash->tag_ways; tndx++) {
+		tags[tndx] = CL_NOTAG;
+	}
+	
+	//	Get the space for the rank arrays, each set has assoc ranks rounded up to a multiple of 8
+	//	so that the replacement order is updated 8 ways at a time.  The padding is RANK_PAD.
+	cash->rank_ways = (ccfg->assoc + 7) & ~7;
+	ranks = aligned_alloc(64, ((int64_t) cash->nmbr_sets * cash->rank_ways * sizeof(uint16_t) + 63) & ~63);
+	if (ranks == NULL) {
+		fprintf(stderr, "ERROR, could not get %lld bytes of memory for ranks of %s cache.\n",
+				(long long) cash->nmbr_sets * cash->rank_ways * (long long) sizeof(uint16_t), cash->name);
+		return -5;
+	}
+	for (rndx = 0; rndx < (int64_t) cash->nmbr_sets * cash->rank_ways; rndx++) {
+		ranks[rndx] = RANK_PAD;
+	}
+	
 	lptr = lines;
 	dptr = data;
 	for (sndx = 0; sndx < cash->nmbr_sets; sndx++) {
 		//	processing for a single set of lines
-		sets[sndx].mru = lptr;
-		sets[sndx].lru = lptr + (ccfg->assoc - 1);
 		sets[sndx].owner = cash;
+		sets[sndx].ways = lptr;
+		sets[sndx].tags = tags + (int64_t) sndx * cash->tag_ways;
+		sets[sndx].rank = ranks + (int64_t) sndx * cash->rank_ways;
 		for (lcnt = 0; lcnt < ccfg->assoc; lcnt++) {
-			lptr->data = dptr;
-			lptr->orig = lptr->data + ccfg->lin_siz;
-			lptr->stat = lptr->orig + ccfg->lin_siz;
-			lptr->owner = cash;
-			if (lcnt == 0) {
-				//	this is MRU so its mru link must wrap to last in set
-				lptr->mru = sets[sndx].lru;
-				lptr->lru = lptr + 1;
-			} else if (lcnt == ccfg->assoc - 1) {
-				//	this is LRU so its lru link must wrap to first in set
-				lptr->mru = lptr - 1;
-				lptr->lru = sets[sndx].mru;
-			} else {
-				lptr->mru = lptr - 1;
-				lptr->lru = lptr + 1;
+			lptr->tag = &sets[sndx].tags[lcnt];
+			sets[sndx].rank[lcnt] = lcnt;		//	first line is MRU, last line is LRU
+			if (data != NULL) {
+				lptr->data = dptr;
+				lptr->orig = lptr->data + ccfg->lin_siz;
+				lptr->stat = lptr->orig + ccfg->lin_siz;
+				dptr += 3 * ccfg->lin_siz;
 			}
+			lptr->owner = cash;
 			//  other values of line init to 0 by calloc()
 			//	values of data, orig, stat also init to 0 by calloc()
 			lptr++;
-			dptr += 3 * ccfg->lin_siz;
 		}
 		//	counters for the set are set to 0 by use of calloc() function.
 	}
@@ -1171,6 +1355,23 @@ int32_t	init_cache(cache *cash, cache_cfg *ccfg) {
 	
 	cash->setmask = ((1 << (int8_t) log2(cash->nmbr_sets)) - 1) << cash->log2blksize;
 	cash->tagmask = 0xffffffffffffffff << cash->log2blksize;
+
+	//	resolve the set index mapping: the -{c}_mapping option if given, otherwise the -scheme
+	//	value for the data caches of the -cache_test level and modulo for the other caches.
+	//	The -cache_test cache maps 64 byte line addresses, the same addresses as the leakage
+	//	statistics, the other caches map the line addresses of their own line size.
+	if (ccfg->mapping >= 0) {
+		init_map(&cash->map, ccfg->mapping, cash->nmbr_sets);
+	} else if (cash->ins_or_data == 1  &&  cash->level == cache_test  &&  cache_test > 0) {
+		init_map(&cash->map, scheme, cash->nmbr_sets);
+	} else {
+		init_map(&cash->map, 0, cash->nmbr_sets);
+	}
+	cash->map.adrs_shift = cash->log2blksize;
+	if (cash->ins_or_data == 1  &&  cash->level == cache_test  &&  cache_test > 0) {
+		cash->map.adrs_shift = 6;
+	}
+	init_reference(cash);		//	reference() variant for the settings of this cache
 	cash->assoc = ccfg->assoc;
 	cash->actual_way = cash->assoc; ///////////////////////////////////////////////////////
 	//printf("Actual way set to %d\n", cash->actual_way);
@@ -1212,6 +1413,34 @@ int32_t	init_cache(cache *cash, cache_cfg *ccfg) {
 
 
 
+//	grow_in_files	make room in the per-file tables for one more input file
+//	in_fnames, unimap, unidlys, and unirepeats are doubled in size whenever they are full
+//	returns 0 for error, 1 for success
+int32_t grow_in_files(void) {
+	int16_t		nmax;			//	new number of entries in the tables
+	
+	if (in_filcnt < in_filmax) {
+		return 1;
+	}
+	if (in_filmax >= INT16_MAX / 2) {
+		printf("Configuration error:  too many input trace files\n");
+		return 0;
+	}
+	nmax = (in_filmax == 0) ? 8 : 2 * in_filmax;
+	in_fnames = realloc(in_fnames, nmax * sizeof(char *));
+	unimap = realloc(unimap, nmax * sizeof(*unimap));
+	unidlys = realloc(unidlys, nmax * sizeof(int32_t));
+	unirepeats = realloc(unirepeats, nmax * sizeof(int16_t));
+	if (in_fnames == NULL  ||  unimap == NULL  ||  unidlys == NULL  ||  unirepeats == NULL) {
+		printf("Configuration error:  unable to allocate memory for %d input trace files\n", nmax);
+		return 0;
+	}
+	in_filmax = nmax;
+	return 1;
+}
+
+
+
 //char		*nxt_str;		//	start of next local argument string
 //char		strings[4000];	//	should be enough space for all option/value strings;
 //char		*tokens[500];	//	pointers for up to 500 tokens (250 option/value pairs)/
@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #define LB32_MASK   0x00000001
 #define LB64_MASK   0x0000000000000001
@@ -44,18 +45,6 @@ static char PI[] = {
     33,  1, 41,  9, 49, 17, 57, 25
 };
 
-/*Expansion table */
-static char E[] = {
-    32,  1,  2,  3,  4,  5,  
-     4,  5,  6,  7,  8,  9,  
-     8,  9, 10, 11, 12, 13, 
-    12, 13, 14, 15, 16, 17, 
-    16, 17, 18, 19, 20, 21, 
-    20, 21, 22, 23, 24, 25, 
-    24, 25, 26, 27, 28, 29, 
-    28, 29, 30, 31, 32,  1
-};
-
 /* Post S-Box permutation */
 static char P[] = {
     16,  7, 20, 21, 
@@ -151,157 +140,130 @@ static char iteration_shift[] = {
 };
 
 /*
- * The DES function
- * input: 64 bit message
- * key: 64 bit key for encryption/decryption
- * mode: 'e' = encryption; 'd' = decryption
+ * The DES function below is table driven.
+ *
+ * The 16 subkeys are only rebuilt (with the PC1/PC2 loops) when the key changes,
+ * since the schemes rekey through generate_rand() but encrypt every access with the
+ * same key.  The rounds use SP tables that combine each S-box with the P
+ * permutation, and the IP and inverse IP permutations use one table of 256
+ * entries for each input byte.  All tables are generated from the FIPS tables
+ * above by des_init_tables(), so the result is bit for bit that of the
+ * original bit at a time loops.
  */
-uint64_t des(uint64_t input, uint64_t key, char mode) {
-    
-    int i, j;
-    
-    /* 8 bits */
-    char row, column;
-    
-    /* 28 bits */
-    uint32_t C                  = 0;
-    uint32_t D                  = 0;
-    
-    /* 32 bits */
-    uint32_t L                  = 0;
-    uint32_t R                  = 0;
-    uint32_t s_output           = 0;
-    uint32_t f_function_res     = 0;
-    uint32_t temp               = 0;
-    
-    /* 48 bits */
-    uint64_t sub_key[16]        = {0};
-    uint64_t s_input            = 0;
-    
-    /* 56 bits */
-    uint64_t permuted_choice_1  = 0;
-    uint64_t permuted_choice_2  = 0;
+static uint32_t des_sp[8][64];          /* S-box j followed by P, indexed by the 6 input bits */
+static uint64_t des_ip[8][256];         /* IP of each byte value at each byte position */
+static uint64_t des_pi[8][256];         /* inverse IP of each byte value at each byte position */
+static __thread uint64_t des_sub_key[16];   /* subkeys of des_cur_key, for each thread */
+static __thread uint64_t des_cur_key;       /* key of des_sub_key */
+static __thread int      des_ready = 0;     /* set once this thread has built a key schedule */
+static pthread_once_t    des_tables_once = PTHREAD_ONCE_INIT;   /* builds the shared tables */
+
+/* bit by bit permutation of the 'n' bit result of table 'tbl' applied to the 'width' bit 'input' */
+static uint64_t des_permute(uint64_t input, char *tbl, int n, int width) {
     
-    /* 64 bits */
-    uint64_t init_perm_res      = 0;
-    uint64_t inv_init_perm_res  = 0;
-    uint64_t pre_output         = 0;
+    uint64_t res = 0;
+    int i;
     
-    /* initial permutation */
-    for (i = 0; i < 64; i++) {
-        
-        init_perm_res <<= 1;
-        init_perm_res |= (input >> (64-IP[i])) & LB64_MASK;
-        
+    for (i = 0; i < n; i++) {
+        res <<= 1;
+        res |= (input >> (width - tbl[i])) & LB64_MASK;
     }
-    
-    L = (uint32_t) (init_perm_res >> 32) & L64_MASK;
-    R = (uint32_t) init_perm_res & L64_MASK;
-        
-    /* initial key schedule calculation */
-    for (i = 0; i < 56; i++) {
-        
-        permuted_choice_1 <<= 1;
-        permuted_choice_1 |= (key >> (64-PC1[i])) & LB64_MASK;
+    return res;
+}
 
-    }
+/* build the 16 subkeys of 'key' */
+static void des_key_schedule(uint64_t key) {
     
+    int i, j;
+    uint32_t C, D;
+    uint64_t permuted_choice_1;
+    
+    permuted_choice_1 = des_permute(key, PC1, 56, 64);
     C = (uint32_t) ((permuted_choice_1 >> 28) & 0x000000000fffffff);
     D = (uint32_t) (permuted_choice_1 & 0x000000000fffffff);
-    
-    /* Calculation of the 16 keys */
-    for (i = 0; i< 16; i++) {
-        
-        /* key schedule */
-        // shifting Ci and Di
+    for (i = 0; i < 16; i++) {
         for (j = 0; j < iteration_shift[i]; j++) {
-            
             C = 0x0fffffff & (C << 1) | 0x00000001 & (C >> 27);
             D = 0x0fffffff & (D << 1) | 0x00000001 & (D >> 27);
-            
         }
-        
-        permuted_choice_2 = 0;
-        permuted_choice_2 = (((uint64_t) C) << 28) | (uint64_t) D ;
-        
-        sub_key[i] = 0;
-        
-        for (j = 0; j < 48; j++) {
-            
-            sub_key[i] <<= 1;
-            sub_key[i] |= (permuted_choice_2 >> (56-PC2[j])) & LB64_MASK;
-            
-        }
-        
+        des_sub_key[i] = des_permute((((uint64_t) C) << 28) | (uint64_t) D, PC2, 48, 56);
     }
+    des_cur_key = key;
+    return;
+}
+
+/* build the SP and IP tables */
+static void des_init_tables(void) {
     
-    for (i = 0; i < 16; i++) {
-        
-        /* f(R,k) function */
-        s_input = 0;
-        
-        for (j = 0; j< 48; j++) {
-            
-            s_input <<= 1;
-            s_input |= (uint64_t) ((R >> (32-E[j])) & LB32_MASK);
-            
-        }
-        
-        /* 
-         * Encryption/Decryption 
-         * XORing expanded Ri with Ki
-         */
-        if (mode == 'd') {
-            // decryption
-            s_input = s_input ^ sub_key[15-i];
-            
-        } else {
-            // encryption
-            s_input = s_input ^ sub_key[i];
-            
-        }
-        
-        /* S-Box Tables */
-        for (j = 0; j < 8; j++) {
-            // 00 00 RCCC CR00 00 00 00 00 00 s_input
-            // 00 00 1000 0100 00 00 00 00 00 row mask
-            // 00 00 0111 1000 00 00 00 00 00 column mask
-            
-            row = (char) ((s_input & (0x0000840000000000 >> 6*j)) >> 42-6*j);
-            row = (row >> 4) | row & 0x01;
-            
-            column = (char) ((s_input & (0x0000780000000000 >> 6*j)) >> 43-6*j);
-            
-            s_output <<= 4;
-            s_output |= (uint32_t) (S[j][16*row + column] & 0x0f);
-            
+    int i, j;
+    char row, column;
+    
+    for (j = 0; j < 8; j++) {
+        for (i = 0; i < 64; i++) {
+            row = (char) (((i >> 4) & 0x02) | (i & 0x01));
+            column = (char) ((i >> 1) & 0x0f);
+            des_sp[j][i] = (uint32_t) des_permute((uint64_t) (S[j][16*row + column] & 0x0f) << (28 - 4*j), P, 32, 32);
         }
-        
-        f_function_res = 0;
-        
-        for (j = 0; j < 32; j++) {
-            
-            f_function_res <<= 1;
-            f_function_res |= (s_output >> (32 - P[j])) & LB32_MASK;
-            
+    }
+    for (j = 0; j < 8; j++) {
+        for (i = 0; i < 256; i++) {
+            des_ip[j][i] = des_permute((uint64_t) i << (8*j), IP, 64, 64);
+            des_pi[j][i] = des_permute((uint64_t) i << (8*j), PI, 64, 64);
         }
-        
-        temp = R;
-        R = L ^ f_function_res;
-        L = temp;
-        
     }
+    return;
+}
+
+/* apply byte table 'tbl' to the 64 bits of 'x' */
+static inline uint64_t des_table_permute(uint64_t tbl[8][256], uint64_t x) {
     
-    pre_output = (((uint64_t) R) << 32) | (uint64_t) L;
-        
-    /* inverse initial permutation */
-    for (i = 0; i < 64; i++) {
+    return tbl[0][x & 0xff] ^ tbl[1][(x >> 8) & 0xff] ^ tbl[2][(x >> 16) & 0xff] ^
+           tbl[3][(x >> 24) & 0xff] ^ tbl[4][(x >> 32) & 0xff] ^ tbl[5][(x >> 40) & 0xff] ^
+           tbl[6][(x >> 48) & 0xff] ^ tbl[7][(x >> 56) & 0xff];
+}
+
+/*
+ * The DES function
+ * input: 64 bit message
+ * key: 64 bit key for encryption/decryption
+ * mode: 'e' = encryption; 'd' = decryption
+ */
+uint64_t des(uint64_t input, uint64_t key, char mode) {
+    
+    int i;
+    uint32_t L, R, f, temp;
+    uint64_t t, k, init_perm_res;
+    
+    if (!des_ready) {
+        pthread_once(&des_tables_once, des_init_tables);
+        des_key_schedule(key);
+        des_ready = 1;
+    } else if (key != des_cur_key) {
+        des_key_schedule(key);
+    }
+    
+    init_perm_res = des_table_permute(des_ip, input);
+    L = (uint32_t) (init_perm_res >> 32) & L64_MASK;
+    R = (uint32_t) init_perm_res & L64_MASK;
+    
+    for (i = 0; i < 16; i++) {
         
-        inv_init_perm_res <<= 1;
-        inv_init_perm_res |= (pre_output >> (64-PI[i])) & LB64_MASK;
+        /* E expansion: bit 33 of t is R bit 32, bits 32..1 are R bits 1..32, bit 0 is R bit 1 */
+        t = ((uint64_t) (R & 1) << 33) | ((uint64_t) R << 1) | (R >> 31);
+        k = (mode == 'd') ? des_sub_key[15-i] : des_sub_key[i];
+        f = des_sp[0][((t >> 28) ^ (k >> 42)) & 0x3f] ^
+            des_sp[1][((t >> 24) ^ (k >> 36)) & 0x3f] ^
+            des_sp[2][((t >> 20) ^ (k >> 30)) & 0x3f] ^
+            des_sp[3][((t >> 16) ^ (k >> 24)) & 0x3f] ^
+            des_sp[4][((t >> 12) ^ (k >> 18)) & 0x3f] ^
+            des_sp[5][((t >>  8) ^ (k >> 12)) & 0x3f] ^
+            des_sp[6][((t >>  4) ^ (k >>  6)) & 0x3f] ^
+            des_sp[7][( t        ^  k       ) & 0x3f];
         
+        temp = R;
+        R = L ^ f;
+        L = temp;
     }
     
-    return inv_init_perm_res;
-    
+    return des_table_permute(des_pi, (((uint64_t) R) << 32) | (uint64_t) L);
 }
@@ -48,7 +48,7 @@
 #include <stdlib.h>
 //  #include <sys/types.h>  // required for <unistd.h> according to 'man getpid', but runs without it on Mac OS X
 #include <unistd.h>			//	needed for getpid()
-//#include <string.h>
+#include <string.h>
 //#include <assert.h>
 
 #include "moola.h"
@@ -69,7 +69,7 @@ int16_t		data_only;				//	flag set when no instructions are traced
 int64_t		flush_rate;				//	flush caches after every flush_rate instructions
 memref		*free_mrs;				//	list of free memref instances
 int16_t		in_filcnt;				//	number of input files to process
-char		*in_fnames[MAX_PIDS];	//	pointer to input file names
+char		**in_fnames;			//	pointer to input file names, 'in_filcnt' entries
 char		*in_format;				//	input file format
 int64_t		instr_offs[MAX_PIDS];	//	instruction address offsets used with -unicore, -unicore_sh
 cache		l1d[MAX_PIDS];			//	array of Level 1 data caches (1 for each processor)
@@ -94,6 +94,7 @@ int16_t		multiexpand;			//	set to read multiple files and expand each to multipl
 int16_t		nmbr_cores;				//	number of cores used in this run
 int16_t		output_sets;			//	causes set statistics to be output when set to 1
 mr_queue	queues[MAX_PIDS];		//	input queue for each processor
+int16_t		read_ahead;				//	set to read trace files with producer threads
 char		*run_name;				//	name applied to this moola run
 char		*seg_code = "GHISO";	//	character codes for memory segment
 //char		*sharemap[MAX_PIDS];	//	directs unicore file data to processors with shared I-adrs
@@ -105,9 +106,11 @@ int64_t		stacktop[MAX_PIDS];		//	current top of stack for each processor
 int64_t		stklmt_cnt[MAX_PIDS];	//	counts number of stack limit actions for each processor
 int64_t		stktop_cnt[MAX_PIDS];	//	counts number of stack actions for each processor
 int16_t		strict_order;			//	set to 1 if strict ordering is requested
-int16_t		*unimap[MAX_PIDS][MAX_PIDS];	//	-unicore file to processors map
-int32_t		unidlys[MAX_PIDS];		//	-unicore replication delay between processor start times
-int16_t		unirepeats[MAX_PIDS];	//	-unicore files repeat counts
+int16_t		tags_only;				//	set to simulate tags and line status only, no line data
+int16_t		trace_cache;			//	set to cache decoded trace files in binary sidecars
+int16_t		(*unimap)[MAX_PIDS+1];	//	-unicore file to processors map, -1 ends each list
+int32_t		*unidlys;				//	-unicore replication delay between processor start times
+int16_t		*unirepeats;			//	-unicore files repeat counts
 char		*version = "Moola beta 1.0.0, May 5, 2013";		//	version string
 
 
@@ -146,6 +149,7 @@ int initial_way = 0;
 int final_way;
 
 uint64_t des_key = 0x0000000000000000;
+uint32_t map_epoch = 1;
 uint64_t  min_addr = 0xffffffffffffffff;
 uint64_t  max_addr = 0x0;
 uint64_t a_number = 0;
@@ -160,15 +164,18 @@ uint64_t a_number = 0;
 int main(int argc, char * argv[]) {
 
 	//int dobench(int16_t procs, char *bench, int16_t shared) {
+	int16_t		*active_fils;			//	indices of the files that still contain trace data, in file order
 	int16_t		active_ques[MAX_PIDS];	//	array of flags indicating active queues
+	int16_t		afil;					//	index into active_fils
 	int64_t		batch_time;				//	time at which this batch began
 	//const char		*bench;					//	pointer to benchmark name from input
 	int64_t		break_adrs;				//	address to trigger breakpoint
 	int64_t		break_lnmbr;			//	input line number of trace to trigger breakpoint
 	int16_t		byt;					//	byte index into data array
+	memref		*done_mrs[MR_PUT_BATCH];	//	processed memrefs waiting to go back to the free list
+	int32_t		ndone = 0;				//	number of memrefs in done_mrs
 	int16_t		fil;					//	loop index for processing multiple -unicore files
 	int64_t		first_acs[MAX_PIDS];	//	time of first instruction for each processor
-	int16_t		input_avail;			//	indicates which files still contain trace data
 	int64_t		instr_count[MAX_PIDS];	//	array of instruction counts 'executed'
 	int64_t		instr_time[MAX_PIDS];	//	array of instruction times within current batch
 	int64_t		in_time;				//	minimum time of input
@@ -179,9 +186,15 @@ int main(int argc, char * argv[]) {
 	int64_t		max_instr;				//	maximum instruction time in this batch
 	int32_t		max_qsize;				//	size of largest input queue
 	int32_t		min_qsize;				//	size of smallest input queue
+	int32_t		qcount;					//	size of the queue just taken from
+	int16_t		rescan_qsize;			//	set when min_qsize and max_qsize must be recomputed
 	int64_t		min_time;				//	finds minimum time of oldest queue entries
 	memref		*mr, *mr1, *mr2;		//	pointers to memrefs
+	memref		*copies[MAX_PIDS];		//	memrefs for the processors of a -unicore file
+	int16_t		ncopies;				//	number of processors mapped to a -unicore file
 	int64_t		next_stat;				//	time of next status print
+	int16_t		nmbr_active;			//	number of files in active_fils
+	int16_t		nxt_active;				//	number of files kept active so far in this pass
 	int16_t		p;						//	loop index for processor loops
 //	int32_t		processor_id[MAX_PIDS];	//	map process ID to processor_id
 	int16_t		pmap;					//	processor index mapped to current file
@@ -195,25 +208,7 @@ int main(int argc, char * argv[]) {
 	int16_t		shared = 0;
 	int32_t		stat;					//	status returned by some functions
 
-int i, j, k, s;
-//for(i=0;i<SCHEMES;i++){   // 8 map schemes
-      for (s=0; s < SETS ; s++){
-          mysets[s].elements = 0;
-          mysets[s].info = 0;
-          mysets[s].set_index_info = 0;
-          mysets[s].tag_info = 0;
-          mysets[s].c_total_info=0;
-          for (j=0; j < 42; j++){
-                mysets[s].num_1[j]=0;
-                mysets[s].p1[j]= 0.0;
-                for (k=0; k< 42; k++){
-                        mysets[s].sum_S[j][k]=0;
-                        mysets[s].sum_D[j][k]=0;
-                }
-                 mysets[s].info_bit[j]=0;
-          }
-      }
-//}
+// the leakage state in mysets is allocated by grow_sets() on the first -csvfile2 access
 
 	
 	sim_pid = getpid();					//	get Moola's current process ID
@@ -236,9 +231,7 @@ int i, j, k, s;
 	
 	//	initialize local processor data structures
 	for (p = 0; p < MAX_PIDS; p++) {
-		queues[p].count = 0;
-		queues[p].newest = NULL;
-		queues[p].oldest = NULL;
+		queue_init(p, 2 * max_mr_queue_size);
 		first_acs[p] = 0;
 		last_acs[p] = 0;
 		instr_count[p] = 0;		//	initialize instruction count for each processor
@@ -247,7 +240,11 @@ int i, j, k, s;
 
 	
 	//	open requested input files
-	input_avail = 0;
+	active_fils = malloc(in_filcnt * sizeof(int16_t));
+	if (active_fils == NULL) {
+		error("Unable to allocate memory for the active input file list", -10);
+	}
+	nmbr_active = 0;
 	
 	for (fil = 0; fil < in_filcnt; fil++) {
 		stat = trace_open(fil);
@@ -255,7 +252,7 @@ int i, j, k, s;
 			printf("Unable to open input trace file %s.\n", in_fnames[fil]);
 			return -3;
 		}
-		input_avail |= (1 << fil);
+		active_fils[nmbr_active++] = fil;
 	}
 	
 
@@ -266,16 +263,24 @@ int i, j, k, s;
                 *new_filename =  *csv_fil_name2;
 		char *file1 = "Results_average_";
 		char *file2 = "Results_by_set_";
-		printf("New_filename: %s\n",concat( concat(file1,csv_fil_name2 ),".csv") );
+		char *res_name = csv_fil_name2;   // with -schemes every Results file name ends in _s{scheme}
+		if (nmbr_schemes > 0) {
+			res_name = malloc(strlen(csv_fil_name2) + 8);
+			sprintf(res_name, "%s_s%d", csv_fil_name2, scheme);
+			if (schemes_open(csv_fil_name2)) {
+				return -1;
+			}
+		}
+		printf("New_filename: %s\n",concat( concat(file1,res_name ),".csv") );
 
-		csvf_2 = fopen( concat( concat(file1,csv_fil_name2 ),".csv") , "w");
+		csvf_2 = fopen( concat( concat(file1,res_name ),".csv") , "w");
                 if (csvf_2 == NULL) {
-                        printf("ERROR:  could not open %s for writing\n",  concat( concat(file1,csv_fil_name2 )) ) ;
+                        printf("ERROR:  could not open %s for writing\n",  concat( concat(file1,res_name )) ) ;
                         return -1;
                 }
-		csvf_3 = fopen(concat( concat(file2,csv_fil_name2),".csv")  , "w" );
+		csvf_3 = fopen(concat( concat(file2,res_name),".csv")  , "w" );
                 if (csvf_2 == NULL) {
-                        printf("ERROR:  could not open %s for writing\n",concat( concat(file2,csv_fil_name2 ))  );
+                        printf("ERROR:  could not open %s for writing\n",concat( concat(file2,res_name ))  );
                         return -1;
                 }
 
@@ -315,14 +320,14 @@ int i, j, k, s;
 ////////////////////////////////////////
 // Change the condition to finish before 	
 //////////////////////////////////////////
-	while (input_avail) {		//  get input data and process it until all end-of-file(s) reached
+	while (nmbr_active) {		//  get input data and process it until all end-of-file(s) reached
 
 		min_qsize = 0;
 		max_qsize = 0;
 		
 		//	Try to get data into each processor until one queue gets too big
 		//	The queue conditions are updated after each active file has read a trace record
-		while (min_qsize <= 100  &&  max_qsize < max_mr_queue_size  && input_avail) {
+		while (min_qsize <= 100  &&  max_qsize < max_mr_queue_size  && nmbr_active) {
 			if (multiexpand) {
 				///////////////////////////////////////////////////////////////////////////////////////
 				//
@@ -340,57 +345,56 @@ int i, j, k, s;
 				//
 				///////////////////////////////////////////////////////////////////////////////////////
 				
-				for (fil = 0; fil < in_filcnt; fil++) {		//	check each input file
-					if (input_avail & (1 << fil)) {			//	is this file active?
-						
-						stat = trace_read(fil, mr1);
-						if (stat <= 0) {
-							if (unirepeats[fil] > 1) {
-								printf("End of input file '%s' reached, reloading it.\n", in_fnames[fil]);
-								trace_close(fil);
-								stat = trace_reopen(fil);
-								if (stat == 0) {
-									fprintf(stderr, "Unable to reopen input trace file %s.\n", in_fnames[fil]);
-									return -3;
-								}
-								unirepeats[fil]--;			//	decrement file repetition count
-								stat = trace_read(fil, mr);
-								if (stat <= 0) {
-									printf("Error getting trace record after reloading file %s.\n", in_fnames[fil]);
-									input_avail &= ~(1 << fil);		//	clear this file's active bit
-									continue;						//	go to next file in for loop
-								}
-							} else {
-								printf("End of input file '%s' reached.\n", in_fnames[fil]);
-								input_avail &= ~(1 << fil);			//	clear this file's active bit
-								continue;							//	go to next file in for loop
+				//	files that reach their end are dropped by not copying them down in active_fils
+				nxt_active = 0;
+				for (afil = 0; afil < nmbr_active; afil++) {	//	check each active input file
+					fil = active_fils[afil];
+					stat = trace_read(fil, mr1);
+					if (stat <= 0) {
+						if (unirepeats[fil] > 1) {
+							printf("End of input file '%s' reached, reloading it.\n", in_fnames[fil]);
+							trace_close(fil);
+							stat = trace_reopen(fil);
+							if (stat == 0) {
+								fprintf(stderr, "Unable to reopen input trace file %s.\n", in_fnames[fil]);
+								return -3;
 							}
-						}
-						mr1->time = mr1->linenmbr;			//	time = linenumber for single cycle interleaving
-						
-						for (p = 0; p < nmbr_cores; p++) {
-							pmap = unimap[fil][p];			//	get current mapping
-							if (pmap < 0) {
-								break;						//	processors for this file done
+							unirepeats[fil]--;			//	decrement file repetition count
+							stat = trace_read(fil, mr1);
+							if (stat <= 0) {
+								printf("Error getting trace record after reloading file %s.\n", in_fnames[fil]);
+								continue;						//	go to next file, this one is dropped
 							}
-							mr2 = get_memref();				//	this will be for queuing
-							*mr2 = *mr1;					//	copy mr1 info to mr2 info
-							mr2->pid = pmap;				//	update processor with mapped id, address offset
-							mr2->asid = asids[pmap];
-							if (mr2->oper == MRINSTR) {
-								mr2->adrs += instr_offs[pmap];
-							} else {
-								mr2->adrs += data_offs[pmap];
-							}
-							mr2->time += unidlys[fil] * p;	//	delay instruction
+						} else {
+							printf("End of input file '%s' reached.\n", in_fnames[fil]);
+							continue;						//	go to next file, this one is dropped
+						}
+					}
+					active_fils[nxt_active++] = fil;	//	this file is still active
+					mr1->time = mr1->linenmbr;			//	time = linenumber for single cycle interleaving
+					
+					for (ncopies = 0; ncopies < nmbr_cores  &&  unimap[fil][ncopies] >= 0; ncopies++);
+					get_memrefs(copies, ncopies);		//	one memref per mapped processor for queuing
+					for (p = 0; p < ncopies; p++) {
+						pmap = unimap[fil][p];			//	get current mapping
+						mr2 = copies[p];
+						*mr2 = *mr1;					//	copy mr1 info to mr2 info
+						mr2->pid = pmap;				//	update processor with mapped id, address offset
+						mr2->asid = asids[pmap];
+						if (mr2->oper == MRINSTR) {
+							mr2->adrs += instr_offs[pmap];
+						} else {
+							mr2->adrs += data_offs[pmap];
+						}
+						mr2->time += unidlys[fil] * p;	//	delay instruction
 #ifdef DEBUG_QUEUE
-							printf("queue_add:  ");
-							print_mr(mr2);
+						printf("queue_add:  ");
+						print_mr(mr2);
 #endif
-							queue_add(mr2->pid, mr2);		//	add to appropriate processor input queue
-						}	//	end for (p = 0; p < nmbr_cores; p++)
-					}	//	end if (input_avail & (1 << fil))   is this file active?
-				}	//	end for (fil = 0; fil < fil_cnt; fil++)
+						queue_add(mr2->pid, mr2);		//	add to appropriate processor input queue
+					}	//	end for (p = 0; p < nmbr_cores; p++)
+				}	//	end for (afil = 0; afil < nmbr_active; afil++)
+				nmbr_active = nxt_active;
 				
 				//  compute queue fullness condition at end of each cycle through the input files
 				min_qsize = 1000000;
@@ -432,11 +436,15 @@ int i, j, k, s;
 				//	memory reference time.
 				////////////////////////////////////////////////////////////////////////////////
 				
-				mr = get_memref();
+				if (trace_read == trace_read_thread) {
+					mr = get_memref_raw();			//	the read-ahead reader overwrites the whole record
+				} else {
+					mr = get_memref();
+				}
 				stat = trace_read(0, mr);
 				if (stat == 0) {
 					printf("End of input file '%s' reached\n", in_fnames[0]);
-					input_avail &= ~(1 << 0);		//	clear this file's active bit
+					nmbr_active = 0;				//	the only file is no longer active
 					break;
 				}
 				//	TBD is this check necessary?  Do we need to have the nmbr_cores specified
@@ -500,21 +508,15 @@ int i, j, k, s;
 		for (p = 0; p < nmbr_cores; p++) {
 			active_ques[p] = (queues[p].count != 0);
 		}
+		rescan_qsize = 1;					//	the first removal recomputes the queue sizes
+		sched_build();						//	order the queues by the time of their oldest entries
 
 		//	process the memref input data starting with oldest data while all queues have entries
 		//	Get more input if min_qsize is below 10; unless the max_qsize is > 800 or EOF was reached
-		while (min_qsize > 20  ||  max_qsize > max_mr_queue_size2  ||  input_avail == 0) {
-			min_time = sim_time + 1000000000;		//	at least 1 queue should be less than this
-			for (p = 0; p < nmbr_cores; p++) {
-				if (queues[p].count != 0) {
-					if (queues[p].oldest->time < min_time) {
-						min_time = queues[p].oldest->time;
-						min_proc = p;
-					}
-				}
-			}
+		while (min_qsize > 20  ||  max_qsize > max_mr_queue_size2  ||  nmbr_active == 0) {
+			min_proc = sched_min(&min_time);		//	processor with the oldest queued reference
 ////////////////
-			if (min_time == sim_time + 1000000000) {
+			if (min_proc < 0  ||  min_time >= sim_time + 1000000000) {
 				break;								//	queue is empty, so break out of while loop
 			}
 			mr = queue_take(min_proc);
@@ -547,21 +549,21 @@ int i, j, k, s;
 
 			ref_time = 0;
 			if (mr->oper == MRINSTR) {
-				ref_time = reference(&l1i[min_proc], mr, NULL);		//	process instruction fetch
+				ref_time = reference_l1(&l1i[min_proc], mr);		//	process instruction fetch
 			} else if (mr->oper < MRMODFY) {
-				ref_time = reference(&l1d[min_proc], mr, NULL);		//	process data reference
+				ref_time = reference_l1(&l1d[min_proc], mr);		//	process data reference
 			} else if (mr->oper == MRMODFY) {
 				mr->oper = MRREAD;
 				for (byt = 0; byt < mr->size; byt++) {
 					mr->data[byt] ^= 5;								//	makes orig data different
 				}
-				ref_time = reference(&l1d[min_proc], mr, NULL);		//	process read reference
+				ref_time = reference_l1(&l1d[min_proc], mr);		//	process read reference
 				mr->oper = MRWRITE;
 				for (byt = 0; byt < mr->size; byt++) {
 					mr->data[byt] ^= 5;								//	back to final written data vals
 				}
 				mr->time = ref_time;								//	indicate new start time for write
-				ref_time = reference(&l1d[min_proc], mr, NULL);	//	process write reference
+				ref_time = reference_l1(&l1d[min_proc], mr);	//	process write reference
 			} else if (mr->oper == XALLOC) {
 				halloc(mr);							//	process this heap allocation
 			} else if (mr->oper == XFREE) {
@@ -656,27 +658,45 @@ int i, j, k, s;
 				next_stat += 1000000;
 			}
 #endif
-			free_memref(mr);						//	return memref to free list
+			done_mrs[ndone++] = mr;					//	return memref to free list with the batch
+			if (ndone == MR_PUT_BATCH) {
+				free_memrefs(done_mrs, ndone);
+				ndone = 0;
+			}
 			if (queues[min_proc].count > 0) {
 				//	delay next reference of this processor until this reference can complete
-				queues[min_proc].oldest->time = ref_time;
+				QUEUE_OLDEST(&queues[min_proc])->time = ref_time;
 			}
+			sched_update(min_proc);					//	replay min_proc with its new oldest entry
 			
 			//	update queue sizes to see if new input should be gathered
 			//	ignore any queues that were empty when removals started
-			min_qsize = max_mr_queue_size;
-			max_qsize = 0;
-			for (p = 0; p < nmbr_cores; p++) {
-				if (active_ques[p] && queues[p].count < min_qsize) {
-					min_qsize = queues[p].count;
+			//	after the first removal only queue min_proc changes, and only by one entry, so the
+			//	queues are scanned again only when it was the largest queue
+			qcount = queues[min_proc].count;
+			if (rescan_qsize  ||  qcount + 1 == max_qsize) {
+				if (rescan_qsize) {
+					min_qsize = max_mr_queue_size;
 				}
-				if (queues[p].count > max_qsize) {
-					max_qsize = queues[p].count;
+				max_qsize = 0;
+				for (p = 0; p < nmbr_cores; p++) {
+					if (rescan_qsize  &&  active_ques[p] && queues[p].count < min_qsize) {
+						min_qsize = queues[p].count;
+					}
+					if (queues[p].count > max_qsize) {
+						max_qsize = queues[p].count;
+					}
 				}
+				rescan_qsize = 0;
+			}
+			if (active_ques[min_proc]  &&  qcount < min_qsize) {
+				min_qsize = qcount;
 			}
-		}	//  end while (min_qsize > 20  ||  max_qsize > max_mr_queue_size2  ||  input_avail == 0)
+		}	//  end while (min_qsize > 20  ||  max_qsize > max_mr_queue_size2  ||  nmbr_active == 0)
+		free_memrefs(done_mrs, ndone);				//	the input gathering reuses them
+		ndone = 0;
 		
-	}	//	while (input_avail)  get input data and process it until end-of-file(s)
+	}	//	while (nmbr_active)  get input data and process it until end-of-file(s)
 	
 	//	Need multiple choice based on file input format, or needs to be indirect pointer
 	for (fil = 0; fil < in_filcnt; fil++) {
@@ -796,6 +816,7 @@ int i, j, k, s;
        
         	compute_entropies(mysets,set__lines);
         	print_results(csvf_2,csvf_3,mysets,scheme,set__lines); 
+        	schemes_finish(set__lines);       // Results files of the other -schemes
 
 // Cose the new file pointer 
 		fclose(csvf_2);	
@@ -34,6 +34,7 @@
 #ifndef moola_moola_h
 #define moola_moola_h
 
+#include <stdio.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <inttypes.h>
@@ -64,6 +65,14 @@
 #define FSIZE 256
 #define VSIZE 256
 
+//	IDs of the symbol names that symbols.c interns before any trace name
+#define SYM_NONE	0		//	""
+#define SYM_UNKNOWN	1		//	"_unknown_"
+#define SYM_GLOBAL	2		//	"_global_"
+#define SYM_HEAP	3		//	"_heap_"
+#define SYM_INSTR	4		//	"_instruction_"
+#define SYM_STACK	5		//	"_stack_"
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //  The following define maximum values for the various data structures
@@ -81,6 +90,9 @@
 //	the maximum number of distributed blocks within a distributed cache array
 #define MAX_DISTR_BLKS 64
 
+//	the number of processed memrefs returned to the free list together by free_memrefs
+#define MR_PUT_BATCH 64
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //  The following define enumerated values for various codes
@@ -128,6 +140,7 @@ typedef struct cache_cfg_rec {
 	char		walloc_pol;	//	write allocate policy (A - alloc, X - off)
 	char		write_pol;	//	write policy (B - write-back, T - write-through)
 	char		write_sets;	//	output sets statistics for the cache when 'T'
+	int8_t		mapping;	//	set index mapping scheme (0-9, see -scheme), -1 => default
 } cache_cfg;
 
 
@@ -147,8 +160,7 @@ struct memref_rec {
 	int64_t		adrs;		//  start address of the memory reference
 	int64_t		time;		//	tracks time of this transfer (see explanation below)
 	int64_t		linenmbr;	//	source file line number that initiated this memref (used for debugging)
-	memref		*next;		//	pointer to next memref in queue or idle list
-	memref		*prev;		//	pointer to previous memref in queue
+	memref		*next;		//	pointer to next memref in idle list
 	int32_t		size;		//	size of transaction; allows up to 4 GByte heap request, 0 => full cache flag
 #ifdef DATAVALS
 	uint8_t		data[MAX_MR_DATA];	//  memory reference data
@@ -161,8 +173,8 @@ struct memref_rec {
 #ifdef GLEIPNIR
 	int64_t		virt_adrs;	//	virtual address
 	int32_t		h_enum;		//	heap enumeration
-	char		fname[128];	//	function name
-	char		vname[128];	//	variable name
+	int32_t		fname_id;	//	function name, interned symbol ID (see symbols.c)
+	int32_t		vname_id;	//	variable name, interned symbol ID (see symbols.c)
 	char		scope[3];	//	scope info
 #endif
 };
@@ -219,13 +231,124 @@ struct memref_rec {
 //	Structure to define the memrec queues used for input transactions to the
 //	processors.  This allows the input trace files to have memory references in
 //  batches of 50 to 1000 instructions, yet extract memory references on a per
-//	instruction interleave.
+//	instruction interleave.  Each queue is a ring of memref pointers; 'head' and
+//	'tail' count the adds and takes so the oldest entry is ring[tail & mask].
+//	The ring is sized by queue_init and doubled by queue_add if a batch overfills it.
 typedef struct queue_rec {
-	memref		*newest;	//	points to newest entry, add to queue here, NULL => empty
-	memref		*oldest;	//	points to oldest entry, take from queue here, NULL => empty
+	memref		**ring;		//	queue entries, 'mask' + 1 of them
+	uint32_t	head;		//	number of entries added, add to queue at ring[head & mask]
+	uint32_t	tail;		//	number of entries taken, take from queue at ring[tail & mask]
+	uint32_t	mask;		//	ring size - 1, the ring size is a power of 2
 	int32_t		count;		//	number of entries in the queue
 } mr_queue;
 
+//	oldest entry of queue 'q', only valid when (q)->count > 0
+#define QUEUE_OLDEST(q)	((q)->ring[(q)->tail & (q)->mask])
+
+
+//	Structures to define the moola_bin binary trace file format (see trace_moola_bin.c).
+//	The file is an mbin_hdr followed by nmbr_recs fixed-width mbin_rec records, so a
+//	record can be copied straight from a memory-mapped file into a memref.
+#define MBIN_MAGIC "MOOLABIN"
+#define MBIN_VERSION 1
+
+typedef struct mbin_hdr_rec {
+	char		magic[8];	//	"MOOLABIN", not null terminated
+	int32_t		version;	//	MBIN_VERSION of the writer
+	int32_t		rec_size;	//	sizeof(mbin_rec) of the writer
+	int64_t		nmbr_recs;	//	number of records following the header
+} mbin_hdr;
+
+typedef struct mbin_rec_rec {
+	int64_t		adrs;		//  start address of the memory reference
+	int64_t		linenmbr;	//	line number of the record in the source text trace
+	int32_t		size;		//	size of transaction
+	int8_t		oper;		//  operation, see definitions for memref
+	int8_t		segmnt;		//	memory segment 0-4: global, heap, instruction, stack, other
+	int8_t		pid;		//	processor ID initiating this request
+	int8_t		asid;		//	ASID of the thread running here
+	uint8_t		data[MAX_MR_DATA];	//  memory reference data (always present in the file)
+} mbin_rec;
+
+
+//	Structures to define the moola_blk compressed binary trace file format written by the
+//	moola_conv converter (see trace_moola_bin.c).  The file is an mblk_hdr, followed by
+//	blocks of blk_recs variable length records, followed by an index with one mblk_ndx
+//	entry for each block.  The delta encoding state is reset at the start of every block
+//	so each block can be decoded independently using the information in its index entry.
+//	The reader checks the offset and first line number of each block against the index.
+#define MBLK_MAGIC "MOOLABLK"
+#define MBLK_VERSION 1
+#define MBLK_RECS 4096			//	default number of records per block
+
+typedef struct mblk_hdr_rec {
+	char		magic[8];	//	"MOOLABLK", not null terminated
+	int32_t		version;	//	MBLK_VERSION of the writer
+	int32_t		blk_recs;	//	number of records in each block (last block may be short)
+	int64_t		nmbr_recs;	//	number of records in the file
+	int64_t		nmbr_blks;	//	number of blocks in the file
+	int64_t		ndx_offset;	//	file offset of the block index
+	int16_t		nmbr_pids;	//	number of per-processor times in each index entry
+	int16_t		has_data;	//	1 => data values follow the size of each data access
+	int32_t		spare;		//	unused, written as 0
+} mblk_hdr;
+
+typedef struct mblk_ndx_rec {
+	int64_t		linenmbr;	//	source line number of the first record of the block
+	int64_t		offset;		//	file offset of the first record of the block
+	int64_t		time[MAX_PIDS];	//	instruction count of each processor before the block
+} mblk_ndx;
+
+
+//	State for writing moola_bin or moola_blk trace files with trace_create_moola_bin,
+//	trace_write_moola_bin and trace_finish_moola_bin.
+typedef struct mbin_wrtr_rec {
+	FILE		*fil;		//	output file
+	mblk_ndx	*ndx;		//	block index entries collected while writing (blocked only)
+	int64_t		ndx_max;	//	number of entries allocated for ndx
+	int64_t		nmbr_recs;	//	number of records written
+	int64_t		nmbr_blks;	//	number of blocks started
+	int64_t		offset;		//	current output file offset
+	int64_t		prev_adrs[MAX_PIDS];	//	previous address of each processor in this block
+	int64_t		prev_line;	//	previous line number in this block
+	int64_t		time[MAX_PIDS];	//	instruction count of each processor
+	int16_t		blocked;	//	0 => moola_bin fixed records, 1 => moola_blk blocks
+	int16_t		has_data;	//	1 => data values are written to moola_blk records
+	int16_t		prev_pid;	//	processor of the previous record in this block, -1 => none
+	int8_t		prev_asid;	//	asid of the previous record in this block
+} mbin_wrtr;
+
+
+//	Key appended after the block index of a '-trace_cache' sidecar (see trace_cache.c).  The
+//	sidecar is only used when the size, modification time, hash, and format all match.
+#define MCACHE_MAGIC "MOOLAKEY"
+
+typedef struct mcache_key_rec {
+	char		magic[8];	//	"MOOLAKEY", not null terminated
+	int64_t		src_size;	//	size of the trace file
+	int64_t		src_mtime;	//	modification time of the trace file
+	uint64_t	src_hash;	//	hash of the start and end of the trace file
+	int64_t		src_lines;	//	number of lines in the trace file
+	char		informat[24];	//	-informat used to decode the trace file
+} mcache_key;
+
+
+//	Parser state for one text trace input file (see trace_moola.c, trace_pin.c, trace_gleipnir.c).
+//	Keeping it per file lets the format readers run for different files in different threads.
+typedef struct parse_ctx_rec {
+	char		*cptr;		//	pointer to next character in ibfr
+	uint8_t		*bytes;		//	pointer to data value bytes
+	void		*gzfil;		//	gzipped trace file for input (gzFile)
+	FILE		*txtfil;	//	text trace file for input
+	int64_t		lineno;		//	line number of most recently read line in the file
+	int64_t		val;		//	temporary generation of an input value
+	int16_t		fndx;		//	index of the file in in_fnames, used for error reporting
+	int16_t		bndx;		//	index to the current byte of data
+	char		c;			//  character from input trace file
+	char		c2;			//  second character from input trace file
+	char		ibfr[616];	//	buffer for input lines (160 moola/pin, 600 gleipnir) + 16 for trace_scan.c loads
+} parse_ctx;
+
 
 
 //  incomplete type definition for cache to allow links from sets and lines back to the
@@ -239,15 +362,15 @@ typedef struct cache_rec	cache;
 ////////////////////////////////////////////////////////////////////////////////
 //	The cacheline structure is the basic structure of the program.  It includes
 //  an address tag, N current data fields, N original data fields, N status fields,
-//  M (sub)block status fields, lru/mru set link fields, operation.
+//  M (sub)block status fields, operation.  The replacement order of the lines
+//  is kept by their set, see cacheset.
 ////////////////////////////////////////////////////////////////////////////////
 
 typedef struct cline_rec	cacheline;
 struct cline_rec {
 	int64_t		adrs;		//  start address of the cacheline
-	cacheline	*lru;		//	less recently used cacheline (for replacement algorithm)
-	cacheline	*mru;		//	more recently used cacheline (for replacement algorithm)
 	cache		*owner;		//	point to cache that owns this line
+	int64_t		*tag;		//	slot of this line in the tag array of its set, see CL_SET_TAG
 	int64_t		alloctime;	//	time of allocation (is last field to align data as
 	int64_t		time;		//	time of last access to this line
 	uint8_t		*data;		//  blocksize bytes of cacheline data
@@ -263,6 +386,14 @@ struct cline_rec {
 };
 
 
+//	The tags of the lines of a set are also kept together in the set's 'tags' array so that
+//	search() compares all of the ways at once.  A way that is not valid holds CL_NOTAG, which
+//	is not the address of any line.  CL_SET_TAG must follow every change of a line's adrs or
+//	valid fields.
+#define CL_NOTAG	((int64_t) -1)
+#define CL_SET_TAG(cl)	(*(cl)->tag = (cl)->valid ? (cl)->adrs : CL_NOTAG)
+
+
 //  Definition of bits in the cache line status byte
 //  bit 0 - set when the byte is valid
 //  bit 1 - set when the byte is dirty
@@ -292,12 +423,17 @@ struct cline_rec {
 ////////////////////////////////////////////////////////////////////////////////
 //  The cache set structure holds the associative set of cachelines that map to
 //	the set address and it maintains activity counters for the set.
+//	The replacement order of the lines is the 'rank' array: rank[w] is the age
+//	of way w, 0 for the most recently used line up to assoc - 1 for the least
+//	recently used line.  The array has rank_ways entries so that it can be
+//	processed 8 ways at a time, the entries past assoc hold RANK_PAD.
 ////////////////////////////////////////////////////////////////////////////////
 
 typedef struct cacheset_rec	cacheset;
 struct cacheset_rec {
-	cacheline	*lru;		//	least recently used cache line
-	cacheline	*mru;		//	most recently used cache line
+	cacheline	*ways;		//	lines of the set in way order, ways[w] has tag tags[w]
+	int64_t		*tags;		//	tag of each way, CL_NOTAG when not valid (tag_ways entries)
+	uint16_t	*rank;		//	age of each way, 0 is MRU and assoc - 1 is LRU (rank_ways entries)
 	cache		*owner;		//	point to cache that owns this set
 	int64_t		access[5];	//	number of accesses to this set (G, H, S, I, O)
 	int64_t		clean[5];	//	number of cleans of a line in this set (G, H, S, I, O)
@@ -309,6 +445,8 @@ struct cacheset_rec {
 	int64_t		wrback[5];	//	number of writebacks for this set (G, H, S, I, O)
 };
 
+#define RANK_PAD	0xffff		//	rank of the unused entries past assoc, above every rank
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //  Cache array data structure
@@ -318,6 +456,44 @@ struct cacheset_rec {
 //  in the simulation
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+//  Set index mapping descriptor
+////////////////////////////////////////////////////////////////////////////////
+//  Each cache maps the line address of an access to a set number through its
+//  set_map.  init_map() resolves the mapping scheme once for the cache and
+//  stores the function for it with the set size values and keys it needs, so
+//  reference() calls map->fn directly without testing the scheme.
+//  The DES scheme keeps the set numbers it computed in a direct mapped memo
+//  table of MAP_MEMO entries indexed by the low line address bits.  An entry is
+//  only valid while its epoch equals map_epoch, which is advanced whenever the
+//  DES key changes, so a rekey invalidates every memo table at once.
+////////////////////////////////////////////////////////////////////////////////
+
+#define MAP_MEMO	65536			//	entries in a set mapping memo table, a power of 2
+
+typedef struct map_memo_rec map_memo;
+struct map_memo_rec {
+	uint64_t	line;				//	line address of the entry
+	int32_t		set;				//	set number of the line address
+	uint32_t	epoch;				//	map_epoch when the set number was computed
+};
+
+typedef struct set_map_rec set_map;
+struct set_map_rec {
+	int32_t		(*fn)(set_map *, uint64_t);	//	returns the set number of a line address
+	int32_t		(*calc)(set_map *, uint64_t);	//	computes the set number when fn is the memo lookup
+	map_memo	*memo;				//	memo table of computed set numbers, NULL => not used
+	uint64_t	set_mask;			//	nmbr_sets - 1, mask of the set bits of a line address
+	uint64_t	low_mask;			//	mask of the set bits kept by the slice scheme (6)
+	uint32_t	key[4];				//	CEASER keys (scheme 8)
+	int32_t		nmbr_sets;			//	number of sets of the cache
+	int8_t		set_bits;			//	log 2 of nmbr_sets
+	int8_t		adrs_shift;			//	shift of a byte address to the line address given to fn
+	int8_t		shift;				//	scheme dependent shift distance
+	int8_t		scheme;				//	mapping scheme used (0-9, see -scheme)
+};
+
+
 //	typedef struct cache_rec cache;		declaration completion
 //			incomplete declaration occurs prior to typedef cacheline
 struct cache_rec {
@@ -332,6 +508,8 @@ struct cache_rec {
 	int64_t		idle_time;			//	time duration that cache was idle
 	int64_t		wait_time;			//	time duration that accesses had to wait due to cache busy
 	int64_t		tagmask;			//	mask to get tag address bits from access address (-1 << log2blksize)
+	set_map		map;				//	maps line addresses to set numbers
+	int64_t		(*ref_fn)(cache *, memref *, cacheline *);	//	reference variant bound by init_reference
 	int64_t		blkmiss[XALLOC];	//	subblock miss count for each access type, w/wo prefetch
 									//  TBD  need to add coherency counters as well
 									//	TBD  divide these by memory segment also???
@@ -356,8 +534,10 @@ struct cache_rec {
 	int8_t		log2blksize;		//	log 2 of block size in bytes (shift distance for set mask to ndx)
 	int8_t		log2sbsize;			//	log 2 of sub-block size in bytes
 //	int8_t		setshift;			//	number of bit positions to shift masked bits to form set index
-	int8_t		assoc;				//	associativity of cache (1-16), 0 => fully associative
-	int8_t		actual_way;			//	actual way for dynamic cache flashing
+	int16_t		assoc;				//	associativity of cache, 0 => fully associative
+	int16_t		tag_ways;			//	entries in the tag array of each set (assoc rounded up to 4)
+	int16_t		rank_ways;			//	entries in the rank array of each set (assoc rounded up to 8)
+	int16_t		actual_way;			//	actual way for dynamic cache flashing
 	
 	int8_t		level;				//	level of this cache; 1 is closest to processor
 	int8_t		prefetch;			//	set to 1 to enable prefetching of next line
@@ -451,13 +631,20 @@ void		create_test_gzfile();									//	tracegz.c
 void		defaults(void);											//	configure.c
 void		error(char *, int);										//	utils.c
 void		free_memref(memref *);									//	utils.c
+void		free_memrefs(memref **mrs, int32_t n);					//	utils.c
 int8_t		get_bit(int8_t *aray, int16_t bit);						//	utils.c
 memref	   *get_memref();											//	utils.c
+memref	   *get_memref_raw();										//	utils.c
+void		get_memrefs(memref **mrs, int32_t n);					//	utils.c
+parse_ctx  *get_parse_ctx(int16_t);							//	trace_moola.c
 void		halloc(memref *);										//	utils.c
 void		hfree(memref *);										//	utils.c
 int32_t		initialize();											//	configure.c
 int32_t		init_cache(cache *, cache_cfg *);						//	configure.c
+void		init_map(set_map *map, int32_t scheme, int32_t nmbr_sets);	//	reference.c
+void		init_reference(cache *cash);							//	reference.c
 char		*int64_to_str(int64_t val, char *str);					//	utils.c
+int32_t		intern_symbol(char *name, int32_t len);					//	symbols.c
 void		invalidate_all(cache *cash);							//	reference.c
 int8_t		is_dead(int64_t adrs, int8_t segment);					//	reference.c
 void		move2_lru(cacheset *set, cacheline *cl);				//	reference.c
@@ -469,11 +656,23 @@ void		print_set(cacheset *set);								//	utils.c
 void		print_set_stats(cache *cash);							//	utils.c
 void		put_bit(int8_t val, int8_t *aray, int16_t bit);			//	utils.c
 void		queue_add(int16_t pid, memref *mr);						//	utils.c
+void		queue_init(int16_t pid, int32_t size);					//	utils.c
 memref	   *queue_take(int16_t pid);								//	utils.c
+cacheline  *rank_find(cacheset *set, int32_t rank);				//	reference.c
 int64_t		reference(cache *cash, memref *mr, cacheline *cl);		//	reference.c
+int64_t		reference_l1(cache *cash, memref *mr);					//	reference.c
 memref	   *ref_split(cache *cash, memref *mr);						//	reference.c
 cacheline  *search(cache *cash, int64_t cladrs, int32_t set);		//	reference.c
+void		search_init(void);										//	reference.c
+void		sched_build(void);										//	utils.c
+void		schemes_add(cache *cash, uint64_t a);					//	schemes.c
+void		schemes_finish(int set_lines);							//	schemes.c
+int32_t		schemes_open(char *name);								//	schemes.c
+void		schemes_sync(void);										//	schemes.c
+int16_t		sched_min(int64_t *time);								//	utils.c
+void		sched_update(int16_t pid);								//	utils.c
 void		set_bit(int8_t *aray, int16_t bit);						//	utils.c
+char	   *symbol_name(int32_t id);								//	symbols.c
 void		trace_close_gleipnir_gz(int16_t fil);					//	trace_gleipnir.c
 int32_t		trace_open_gleipnir_gz(int16_t);						//	trace_gleipnir.c
 int32_t		trace_read_gleipnir_gz(int16_t, memref *);				//	trace_gleipnir.c
@@ -482,6 +681,33 @@ void		trace_close_gleipnir_txt(int16_t fil);					//	trace_gleipnir.c
 int32_t		trace_open_gleipnir_txt(int16_t);						//	trace_gleipnir.c
 int32_t		trace_read_gleipnir_txt(int16_t, memref *);				//	trace_gleipnir.c
 int32_t		trace_reopen_gleipnir_txt(int16_t);						//	trace_gleipnir.c
+void		trace_close_moola_bin(int16_t fil);						//	trace_moola_bin.c
+int32_t		trace_open_moola_bin(int16_t);							//	trace_moola_bin.c
+int32_t		trace_read_moola_bin(int16_t, memref *);				//	trace_moola_bin.c
+int32_t		trace_reopen_moola_bin(int16_t);						//	trace_moola_bin.c
+void		trace_close_moola_blk(int16_t fil);						//	trace_moola_bin.c
+int32_t		trace_open_moola_blk(int16_t);							//	trace_moola_bin.c
+int32_t		trace_read_moola_blk(int16_t, memref *);				//	trace_moola_bin.c
+int32_t		trace_reopen_moola_blk(int16_t);						//	trace_moola_bin.c
+int32_t		trace_create_moola_bin(mbin_wrtr *, char *, int16_t, int16_t);	//	trace_moola_bin.c
+int32_t		trace_finish_moola_bin(mbin_wrtr *);					//	trace_moola_bin.c
+int32_t		trace_write_moola_bin(mbin_wrtr *, memref *);			//	trace_moola_bin.c
+int32_t		trace_open_moola_blk_file(int16_t, char *);				//	trace_moola_bin.c
+int16_t		trace_data_moola_blk(int16_t);							//	trace_moola_bin.c
+void		trace_close_cache(int16_t fil);							//	trace_cache.c
+int32_t		trace_open_cache(int16_t);								//	trace_cache.c
+int32_t		trace_read_cache(int16_t, memref *);					//	trace_cache.c
+int32_t		trace_reopen_cache(int16_t);							//	trace_cache.c
+void		trace_cache_init(void);									//	trace_cache.c
+void		scan_dec_scalar(parse_ctx *);							//	trace_scan.c
+void		scan_hex_scalar(parse_ctx *);							//	trace_scan.c
+int32_t		scan_hexbytes_scalar(parse_ctx *);						//	trace_scan.c
+void		trace_scan_init(void);									//	trace_scan.c
+void		trace_close_thread(int16_t fil);						//	trace_thread.c
+int32_t		trace_open_thread(int16_t);								//	trace_thread.c
+int32_t		trace_read_thread(int16_t, memref *);					//	trace_thread.c
+int32_t		trace_reopen_thread(int16_t);							//	trace_thread.c
+void		trace_thread_init(void);								//	trace_thread.c
 void		trace_close_moola_txt(int16_t fil);						//	trace_moola.c
 int32_t		trace_open_moola_txt(int16_t);							//	trace_moola.c
 int32_t		trace_read_moola_txt(int16_t, memref *);				//	trace_moola.c
@@ -525,7 +751,7 @@ extern	int64_t		flush_rate;				//	flush caches after every flush_rate instructio
 extern	memref		*free_mrs;				//	list of idle memref instances
 extern	int64_t		instr_offs[MAX_PIDS];	//	instruction address offsets used with -unicore, -unicore_sh
 extern	int16_t		in_filcnt;				//	number of input files to process
-extern	char		*in_fnames[MAX_PIDS];	//	pointer to input file names
+extern	char		**in_fnames;			//	pointer to input file names, 'in_filcnt' entries
 extern	char		*in_format;				//	input file format
 extern	cache		l1d[MAX_PIDS];			//	array of Level 1 data caches (1 for each processor)
 extern	cache_cfg	l1d_cfg;				//	configuration values for Level 1 data cache
@@ -548,7 +774,12 @@ extern	int16_t		multiexpand;			//	set to read multiple files and expand each to
 extern	int16_t		nmbr_cores;				//	number of cores used in this run
 extern	int16_t		output_sets;			//	causes set statistics to be output when set to 1
 extern	mr_queue	queues[MAX_PIDS];		//	input queue for each processor
+extern	parse_ctx	**parse_ctxs;			//	parser context for each input file
+extern	int16_t		read_ahead;				//	set to read trace files with producer threads
 extern	char		*run_name;				//	name applied to this moola run
+extern	void		(*scan_dec)(parse_ctx *);		//	decimal field decoder selected by trace_scan_init
+extern	void		(*scan_hex)(parse_ctx *);		//	hexadecimal field decoder selected by trace_scan_init
+extern	int32_t		(*scan_hexbytes)(parse_ctx *);	//	hex data bytes decoder selected by trace_scan_init
 extern	char		*seg_code;				//	character codes for memory segment
 extern	char		*sharemap[MAX_PIDS];	//	directs unicore file data to processors with shared I-adrs
 extern	pid_t		sim_pid;				//	process id of the current Moola simulation run
@@ -559,13 +790,15 @@ extern	int64_t		stacktop[MAX_PIDS];		//	current top of stack for each processor
 extern	int64_t		stklmt_cnt[MAX_PIDS];	//	counts number of stack limit actions for each processor
 extern	int64_t		stktop_cnt[MAX_PIDS];	//	counts number of stack actions for each processor
 extern	int16_t		strict_order;			//	set to 1 if strict ordering is requested
+extern	int16_t		tags_only;				//	set to simulate tags and line status only, no line data
+extern	int16_t		trace_cache;			//	set to cache decoded trace files in binary sidecars
 extern	void		(*trace_close)(int16_t);			//	close function pointer for trace files
 extern	int32_t		(*trace_open)(int16_t);				//	open function pointer for trace files
 extern	int32_t		(*trace_read)(int16_t, memref *);	//	read function pointer for trace files
 extern	int32_t		(*trace_reopen)(int16_t);			//	reopen function pointer for trace files
-extern	int16_t		*unimap[MAX_PIDS][MAX_PIDS];		//	-unicore file to processors map
-extern	int32_t		unidlys[MAX_PIDS];		//	-unicore replication delay between processor start times
-extern	int16_t		unirepeats[MAX_PIDS];	//	-unicore files repeat counts
+extern	int16_t		(*unimap)[MAX_PIDS+1];	//	-unicore file to processors map, -1 ends each list
+extern	int32_t		*unidlys;				//	-unicore replication delay between processor start times
+extern	int16_t		*unirepeats;			//	-unicore files repeat counts
 extern	char		*version;				//	version string
 
 int             scheme;
@@ -579,6 +812,7 @@ int 		initial_way;
 int 		final_way;
 int 		reset_DES;
 uint64_t 	des_key;
+uint32_t	map_epoch;			//	advanced on each DES key change to invalidate set mapping memos
 uint64_t        counter;
 uint64_t       max_addr,min_addr;
 uint64_t 	a_number;
@@ -604,14 +838,22 @@ struct sets{
    // correlation part
    uint32_t sum_S[42][42];
    uint32_t sum_D[42][42];
+   uint64_t slice[42];        // bit slices of the buffered addresses, see estimatePs
+   uint32_t nbuf;             // number of buffered addresses
    double info_bit[42];
    double corr_info[42];
    double c_total_info;
 };
 
-#define SETS 16384
 #define SCHEMES 10
-struct sets mysets[SETS];
+struct sets *mysets;          // leakage state of each set of the cache_test cache, see grow_sets
+int nmbr_mysets;              // number of sets allocated in mysets
+int8_t schemes[SCHEMES];      // -schemes list, schemes[0] is the scheme simulated
+int nmbr_schemes;             // number of -schemes values, 0 => only -scheme
+
+void compute_entropies(struct sets *mysets, int set_lines);                                 // reference.c
+void estimatePs(struct sets *mysets, uint64_t a);                                           // reference.c
+void print_results(FILE *fp, FILE *fp2, struct sets *mysets, int scheme, int set_lines);   // reference.c
 
 #endif
 
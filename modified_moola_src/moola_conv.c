@@ -0,0 +1,183 @@
+//
+//  moola_conv.c  (trace file converter for Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//  moola_conv reads a trace file in any of the input formats understood by Moola and writes
+//	it as a moola_blk (default) or moola_bin binary trace file.  A trace is converted once and
+//	then replayed by any number of Moola runs with '-informat moola_blk' without paying for
+//	the decompression and text parsing of the original trace on every run.
+//
+//	usage:  moola_conv -informat string [-outformat moola_blk | moola_bin] [-data] [-cores int] infile outfile
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "moola.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//	global variables used by the trace file access functions
+////////////////////////////////////////////////////////////////////////////////
+
+int16_t		in_filcnt;				//	number of input files to process
+char		**in_fnames;			//	pointer to input file names
+int16_t		nmbr_cores;				//	number of cores, gleipnir thread IDs are mapped modulo this
+
+
+//	table of the input formats that can be converted, names match the moola -informat option
+typedef struct conv_fmt_rec {
+	char		*name;								//	-informat name of the format
+	int32_t		(*open)(int16_t);					//	open function for the format
+	int32_t		(*read)(int16_t, memref *);			//	read function for the format
+	void		(*close)(int16_t);					//	close function for the format
+	int16_t		has_data;							//	1 => format provides data values, -1 => file header flag
+} conv_fmt;
+
+static conv_fmt	formats[] = {
+	{"gleipnir",		trace_open_gleipnir_txt,	trace_read_gleipnir_txt,	trace_close_gleipnir_txt,	0},
+	{"gleipnirgz",		trace_open_gleipnir_gz,		trace_read_gleipnir_gz,		trace_close_gleipnir_gz,	0},
+	{"moola",			trace_open_moola_txt,		trace_read_moola_txt,		trace_close_moola_txt,		0},
+	{"moola_bin",		trace_open_moola_bin,		trace_read_moola_bin,		trace_close_moola_bin,		1},
+	{"moola_blk",		trace_open_moola_blk,		trace_read_moola_blk,		trace_close_moola_blk,		-1},
+	{"moola_gz",		trace_open_moola_gz,		trace_read_moola_gz,		trace_close_moola_gz,		0},
+	{"moola_value",		trace_open_moola_txt,		trace_read_moola_valtxt,	trace_close_moola_txt,		1},
+	{"moola_valuegz",	trace_open_moola_gz,		trace_read_moola_valgz,		trace_close_moola_gz,		1},
+	{"pin",				trace_open_pin_txt,			trace_read_pin_txt,			trace_close_pin_txt,		0},
+	{"pin_gz",			trace_open_pin_gz,			trace_read_pin_gz,			trace_close_pin_gz,			0},
+	{NULL,				NULL,						NULL,						NULL,						0}
+};
+
+static char		*usage =
+	"usage:  moola_conv -informat string [-outformat moola_blk | moola_bin] [-data] [-cores int] infile outfile\n"
+	"  -informat   format of infile, any Moola '-informat' value:  gleipnir, gleipnirgz, moola,\n"
+	"              moola_bin, moola_blk, moola_gz, moola_value, moola_valuegz, pin, pin_gz\n"
+	"  -outformat  format of outfile (moola_blk)\n"
+	"  -data       keep data values in a moola_blk outfile (default for moola_bin, the _value formats\n"
+	"              and a moola_blk infile that has data values)\n"
+	"  -cores      number of cores that gleipnir thread IDs are mapped onto (32)\n";
+
+
+
+int main(int argc, char * argv[]) {
+	int			arg;				//	command line argument index
+	conv_fmt	*fmt;				//	selected input format
+	char		*informat;			//	name of the input format
+	char		*outformat;			//	name of the output format
+	char		*files[2];			//	input and output file names
+	int16_t		fcnt;				//	number of file names seen
+	int16_t		has_data;			//	1 => write data values
+	int16_t		blocked;			//	1 => moola_blk output, 0 => moola_bin output
+	memref		mr;					//	trace record being converted
+	mbin_wrtr	wr;					//	writer state for the output file
+	int64_t		count;				//	number of records converted
+
+	informat = NULL;
+	outformat = "moola_blk";
+	has_data = -1;					//	-1 => use the default for the input format
+	nmbr_cores = MAX_PIDS;
+	fcnt = 0;
+	for (arg = 1; arg < argc; arg++) {
+		if (strcmp(argv[arg], "-informat") == 0  &&  arg + 1 < argc) {
+			informat = argv[++arg];
+		} else if (strcmp(argv[arg], "-outformat") == 0  &&  arg + 1 < argc) {
+			outformat = argv[++arg];
+		} else if (strcmp(argv[arg], "-cores") == 0  &&  arg + 1 < argc) {
+			nmbr_cores = strtol(argv[++arg], NULL, 0);
+			if (nmbr_cores < 1  ||  nmbr_cores > MAX_PIDS) {
+				printf("moola_conv:  -cores must be from 1 to %d\n", MAX_PIDS);
+				return -1;
+			}
+		} else if (strcmp(argv[arg], "-data") == 0) {
+			has_data = 1;
+		} else if (argv[arg][0] != '-'  &&  fcnt < 2) {
+			files[fcnt++] = argv[arg];
+		} else {
+			printf("moola_conv:  unexpected argument '%s'\n%s", argv[arg], usage);
+			return -1;
+		}
+	}
+	if (informat == NULL  ||  fcnt != 2) {
+		printf("%s", usage);
+		return -1;
+	}
+	for (fmt = formats; fmt->name != NULL; fmt++) {
+		if (strcmp(fmt->name, informat) == 0) {
+			break;
+		}
+	}
+	if (fmt->name == NULL) {
+		printf("moola_conv:  '%s' is not a valid choice for -informat\n%s", informat, usage);
+		return -1;
+	}
+	if (strcmp(outformat, "moola_blk") == 0) {
+		blocked = 1;
+	} else if (strcmp(outformat, "moola_bin") == 0) {
+		blocked = 0;
+	} else {
+		printf("moola_conv:  '%s' is not a valid choice for -outformat\n%s", outformat, usage);
+		return -1;
+	}
+
+	trace_scan_init();
+	in_fnames = files;
+	in_filcnt = 1;
+	if (fmt->open(0) == 0) {
+		return -3;
+	}
+	if (has_data < 0) {
+		has_data = fmt->has_data;
+		if (has_data < 0) {
+			has_data = trace_data_moola_blk(0);		//	moola_blk keeps the setting of the input file
+		}
+	}
+	if (trace_create_moola_bin(&wr, files[1], blocked, has_data) == 0) {
+		fmt->close(0);
+		return -3;
+	}
+
+	count = 0;
+	while (1) {
+		memset(&mr, 0, sizeof(mr));
+		if (fmt->read(0, &mr) <= 0) {
+			break;
+		}
+		if (trace_write_moola_bin(&wr, &mr) == 0) {
+			printf("ERROR:  could not write record %lld to '%s'\n", (long long) count, files[1]);
+			fmt->close(0);
+			trace_finish_moola_bin(&wr);
+			return -4;
+		}
+		count++;
+	}
+	fmt->close(0);
+	if (trace_finish_moola_bin(&wr) == 0) {
+		printf("ERROR:  could not complete '%s'\n", files[1]);
+		return -4;
+	}
+	printf("Converted %lld trace records from '%s' (%s) to '%s' (%s) in %lld blocks.\n",
+		   (long long) count, files[0], informat, files[1], outformat,
+		   (long long) (blocked ? (count + MBLK_RECS - 1) / MBLK_RECS : 0));
+	return 0;
+}
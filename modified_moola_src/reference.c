@@ -28,20 +28,36 @@
 //      clean_all		processor command to mark all cache lines as clean
 //      cl_init			moola support function to initializes a cacheline before using it
 //      is_dead			moola support function to determine if address is dead memory
+//      init_map		selects the set index mapping function and parameters of a cache
+//      init_reference	binds the reference function variant for the settings of a cache
 //      invalidate_all	processor command to mark all cache lines as invalid
 //      move2_lru		moola support function to make a cache line the LRU
 //      move2_mru		moola support function to make a cacge line the MRU
 //      print_cntrs		moola debugging function to print counter values
+//      rank_find		finds the cache line of a set that has a given replacement rank
 //      reference		implements a processor memory reference to a cache
+//      ref_body		the reference body, compiled into variants for the fixed cache settings
+//      reference_l1	processor reference to an L1 cache, completing aligned hits directly
 //      ref_split		a reference that crosses cache lines calls this to create 2 references
 //      search			searches a set of cache lines for a tag match making a "hit" or "miss"
+//      search_init		selects the tag compare used by search for this processor
 //      update_cl		updates cache line structures to implement a cache line move between levels
+//      update_tag		updates the status of a cache line for a -tags_only reference
 //
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <math.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__x86_64__)  ||  defined(__i386__)
+#include <immintrin.h>
+#define SEARCH_X86 1
+#endif
 #include "moola.h"
 #include "des.h"
 #include <inttypes.h>
@@ -104,23 +120,21 @@ uint64_t special_rot(uint64_t a, uint32_t num_bits, unsigned int c) {
 }
 */
 
+// Intel slice hash.  Each slice function bit F[k] is the XOR of a fixed set of
+// address bits 6-34, so it is the parity of the address under the mask of those bits.
+static const uint64_t slice_mask[7] = {
+	0x169461040ULL, 0x39bca3080ULL, 0x717946100ULL, 0x62f28c200ULL,
+	0x45e518400ULL, 0x0bca30800ULL, 0x0d73df000ULL
+};
+
 int  intel_slide_case(uint64_t a){
-        unsigned int i;
-        unsigned int A[35];
-	// asign the A[] values to the position
-	for (i=6;i<35;i++){
-		A[i] = a>>i & 1;
-	}
+	unsigned int F[7];
+	unsigned int i;
 
 	// First step
-	unsigned int F[7];
-	F[0] = A[6]^A[12]^A[17]^A[18]^A[22]^A[24]^A[27]^A[29]^A[30]^A[32];
-	F[1] = A[7]^A[12]^A[13]^A[17]^A[19]^A[22]^A[23]^A[24]^A[25]^A[27]^A[28]^A[31]^A[32]^A[33];	
-	F[2] = A[8]^A[13]^A[14]^A[18]^A[20]^A[23]^A[24]^A[25]^A[26]^A[28]^A[32]^A[33]^A[34];
-	F[3] = A[9]^A[14]^A[15]^A[19]^A[21]^A[24]^A[25]^A[26]^A[27]^A[29]^A[33]^A[34];
-	F[4] = A[10]^A[15]^A[16]^A[20]^A[22]^A[25]^A[26]^A[27]^A[28]^A[30]^A[34];
-	F[5] = A[11]^A[16]^A[17]^A[21]^A[23]^A[26]^A[27]^A[28]^A[29]^A[31];
-	F[6] = A[12]^A[13]^A[14]^A[15]^A[16]^A[18]^A[19]^A[20]^A[21]^A[24]^A[25]^A[26]^A[28]^A[30]^A[31];
+	for (i=0;i<7;i++){
+		F[i] = __builtin_parityll(a & slice_mask[i]);
+	}
 
 	// Second step
 	unsigned int S[3];
@@ -130,7 +144,6 @@ int  intel_slide_case(uint64_t a){
 
 	unsigned int  s=0;
 	s = (S[2]<<2) | (S[1]<<1) |  S[0];	
-//	printf("%d%d%d  %d \n", S[2],S[1], S[0], s);
 	return s;	
 }
 
@@ -138,446 +151,245 @@ void  generate_rand(uint64_t *des_key) {
     int i;
 
     uint64_t r = 0;
+    schemes_sync();   // -schemes runs map their buffered addresses with the old key
     // Generate RND 48 bits number
     for (i = 0; i < 8; ++i) {
         r = (r << 12) | (rand()& 0xFF);
     }
     // Apply mask to be sure that is 48 bits
     *des_key = r & 0xFFFFFFFFFFFFFFFF; 
+    map_epoch++;   // the set mapping memos hold sets of the old key
     return ;
 }
 
 
+// CEASER Feistel network on 20 bit halves.  In each of the 4 stages every S-box
+// output bit is the XOR of a fixed set of bits of the stage input and of the stage
+// key, and the P-box only moves bits, so bit i of the P-box output is
+//	parity(input & ceaser_in_mask[stage][i]) ^ parity(key & ceaser_key_mask[stage][i])
+// The masks below already include the P-box moves (stage 4 never sets S-box bit 2,
+// so its P-box output bit 18 is always 0).  The function is linear in the input, so
+// ceaser_tbl holds the output for each byte of the input, with the key bits folded
+// into the table of the low byte.  The tables are rebuilt when the keys change.
+static const uint32_t ceaser_in_mask[4][20] = {
+	{0x003ff, 0xaaaaa, 0x55555, 0xe5b0a, 0xfcf00, 0x8cdd2, 0x32bf0, 0xdd2e0, 0xaf3c0, 0x3ef80,
+	 0x3ff00, 0x7fe00, 0x567a8, 0xcea8a, 0xf6f00, 0x1cbca, 0x9c3f0, 0xdd1e0, 0x6dbc0, 0xc0ab7},
+	{0x003ff, 0xc0ab7, 0xaaaaa, 0x55555, 0xe5b0a, 0xfcf00, 0x8cdd2, 0x32bf0, 0xdd2e0, 0xaf3c0,
+	 0x3ef80, 0x3ff00, 0x7fe00, 0x567a8, 0xcea8a, 0xf6f00, 0x1cbca, 0x9c3f0, 0x6dbc0, 0x003ff},
+	{0xfcf00, 0x8cdd2, 0x32bf0, 0xdd2e0, 0xaf3c0, 0x3ef80, 0x3ff00, 0x7fe00, 0x567a8, 0xf6f00,
+	 0x1cbca, 0x9c3f0, 0xdd1e0, 0x6dbc0, 0x003ff, 0xc0ab7, 0xaaaaa, 0x55555, 0xe5b0a, 0xcea8a},
+	{0xdd1e0, 0x6dbc0, 0x003ff, 0xc0ab7, 0xaaaaa, 0x55555, 0xe5b0a, 0xfcf00, 0x8cdd2, 0x32bf0,
+	 0xdd2e0, 0xaf3c0, 0x3ef80, 0x3ff00, 0x7fe00, 0x567a8, 0xcea8a, 0xf6f00, 0x00000, 0x9c3f0}
+};
+static const uint32_t ceaser_key_mask[4][20] = {
+	{0x003ff, 0x003ff, 0x25a8f, 0x69ad4, 0x372b8, 0xf31a4, 0x39b68, 0x37bc0, 0x0faf0, 0xffc00,
+	 0xb32a9, 0x02b3f, 0x23a97, 0x6a9d4, 0x372b8, 0xf518c, 0x33758, 0x36fc0, 0x4db70, 0xaaaaa},
+	{0x003ff, 0xaaaaa, 0x003ff, 0x25a8f, 0x69ad4, 0x372b8, 0xf31a4, 0x39b68, 0x37bc0, 0x0faf0,
+	 0xffc00, 0xb32a9, 0x02b3f, 0x23a97, 0x6a9d4, 0x372b8, 0xf518c, 0x33758, 0x4db70, 0x003ff},
+	{0x372b8, 0xf31a4, 0x39b68, 0x37bc0, 0x0faf0, 0xffc00, 0xb32a9, 0x02b3f, 0x23a97, 0x372b8,
+	 0xf518c, 0x33758, 0x36fc0, 0x4db70, 0x003ff, 0xaaaaa, 0x003ff, 0x25a8f, 0x69ad4, 0x6a9d4},
+	{0x36fc0, 0x4db70, 0x003ff, 0xaaaaa, 0x003ff, 0x25a8f, 0x69ad4, 0x372b8, 0xf31a4, 0x39b68,
+	 0x37bc0, 0x0faf0, 0xffc00, 0xb32a9, 0x02b3f, 0x23a97, 0x6a9d4, 0x372b8, 0x00000, 0x33758}
+};
+static uint32_t ceaser_tbl[4][3][256];		// stage output for each input byte, keys in byte 0
+static uint32_t ceaser_keys[4];			// keys of ceaser_tbl
+static int ceaser_ready = 0;			// set once ceaser_tbl is built
+
+
+static void ceaser_init(uint32_t key[4]){
+	int st, pos, v, i;
+	uint32_t out;
+
+	for (st=0;st<4;st++){
+		ceaser_keys[st] = key[st];
+		for (pos=0;pos<3;pos++){
+			for (v=0;v<256;v++){
+				out = 0;
+				for (i=0;i<20;i++){
+					out |= (uint32_t) __builtin_parity(((uint32_t) v << 8*pos) & ceaser_in_mask[st][i]) << i;
+					if (pos == 0) {
+						out ^= (uint32_t) __builtin_parity(key[st] & ceaser_key_mask[st][i]) << i;
+					}
+				}
+				ceaser_tbl[st][pos][v] = out;
+			}
+		}
+	}
+	ceaser_ready = 1;
+}
+
+
+static inline uint32_t ceaser_stage(int st, uint32_t x){
+	return ceaser_tbl[st][0][x & 0xff] ^ ceaser_tbl[st][1][(x >> 8) & 0xff] ^ ceaser_tbl[st][2][(x >> 16) & 0x0f];
+}
+
+
 uint64_t ceaser_address(uint64_t a, uint32_t key1, uint32_t key2, uint32_t key3, uint32_t key4 ){
-        // a has 20 bits. Divive by L and R , 20 bits each
+        // a has 40 bits. Divide by L and R , 20 bits each
         // Key has 80 bit =  k1,k2.k3,k4
-        uint32_t L=0, final_L=0;
-        uint32_t R=0, final_R=0; 
-	uint32_t R1=0,R2=0,R3=0;
-	uint32_t L1=0,L2=0,L3=0;
-	unsigned int r1[20], r2[20], r3[20];
-	unsigned int l1[20], l2[20], l3[20];
-	unsigned int s1[20], s2[20], s3[20], s4[20];
-	unsigned int y1[20], y2[20], y3[20], y4[20];
-	unsigned int k1[20], k2[20], k3[20], k4[20];
-	uint64_t final_a=0;	
+	uint32_t key[4];
+	uint32_t L, R, L2, R2, L3, R3;
+
+	key[0] = key1 & 0xFFFFF;
+	key[1] = key2 & 0xFFFFF;
+	key[2] = key3 & 0xFFFFF;
+	key[3] = key4 & 0xFFFFF;
+	if (!ceaser_ready  ||  key[0] != ceaser_keys[0]  ||  key[1] != ceaser_keys[1]
+	    ||  key[2] != ceaser_keys[2]  ||  key[3] != ceaser_keys[3]){
+		ceaser_init(key);
+	}
 
 	R = a & 0xFFFFF;
-	L = (a >> 20);
-
-	// printf("address = 0x%lx  L = 0x%lx  R = 0x%lx  \n", a,L,R);
+	L = (a >> 20) & 0xFFFFF;
 
-	// Precalc of bits 
-	unsigned int i;
-        // asign the k[] values to the bit position. Initialization 
-        for (i=0;i<20;i++){
-                k1[i] = key1>>i & 0x1;
-		k2[i] = key2>>i & 0x1;
-		k3[i] = key3>>i & 0x1;
-		k4[i] = key4>>i & 0x1;
-	        r1[i] = R>>i & 0x1;
-		l1[i] = L>>i & 0x1;
-		s1[i] = 0;
-		s2[i] = 0;
-		s3[i] = 0;
-		s4[i] = 0;
-		y1[i] = 0;
-                y2[i] = 0;
-                y3[i] = 0;
-                y4[i] = 0;
+	R2 = R ^ ceaser_stage(0, L);		// stage 1
+	L2 = L ^ ceaser_stage(1, R2);		// stage 2
+	L3 = R2 ^ ceaser_stage(2, L2);		// stage 3
+	R3 = L2 ^ ceaser_stage(3, L3);		// stage 4
 
-        }
+	// Generate the final address with L3 and R3 as L' and R' respectively
+	// (the shift is done in 32 bits, as it always has been)
+	return (uint32_t) (L3 << 20) | R3;
+}
 
-	////// ------- STAGE 1 ----------------------------------------------- ///
-	// first S-Box
-	s1[0]= l1[0]^l1[1]^l1[2]^l1[3]^l1[4]^l1[5]^l1[6]^l1[7]^l1[8]^l1[9] ^ k1[0]^k1[1]^k1[2]^k1[3]^k1[4]^k1[5]^k1[6]^k1[7]^k1[8]^k1[9];
-	s1[1]= l1[0]^l1[1]^l1[2]^l1[4]^l1[5]^l1[7]^l1[9]^l1[11]^l1[18]^l1[19] ^ k1[1]^k1[3]^k1[5]^k1[7]^k1[9]^k1[11]^k1[13]^k1[15]^k1[17]^k1[19];
-	s1[2]= l1[1]^l1[3]^l1[5]^l1[7]^l1[9]^l1[11]^l1[13]^l1[15]^l1[17]^l1[19] ^ k1[0]^k1[1]^k1[2]^k1[3]^k1[4]^k1[5]^k1[6]^k1[7]^k1[8]^k1[9];
-	s1[3]= l1[0]^l1[2]^l1[4]^l1[6]^l1[8]^l1[10]^l1[12]^l1[14]^l1[16]^l1[18] ^ k1[0]^k1[1]^k1[2]^k1[3]^k1[7]^k1[9]^k1[11]^k1[12]^k1[14]^k1[17];
-	s1[4]= l1[1]^l1[3]^l1[8]^l1[9]^l1[11]^l1[12]^l1[14]^l1[17]^l1[18]^l1[19] ^ k1[2]^k1[4]^k1[6]^k1[7]^k1[9]^k1[11]^k1[12]^k1[15]^k1[17]^k1[18];
-	s1[5]= l1[8]^l1[9]^l1[10]^l1[11]^l1[14]^l1[15]^l1[16]^l1[17]^l1[18]^l1[19] ^ k1[3]^k1[4]^k1[5]^k1[7]^k1[9]^k1[12]^k1[13]^k1[14]^k1[16]^k1[17];
-	s1[6]= l1[1]^l1[4]^l1[6]^l1[7]^l1[8]^l1[10]^l1[11]^l1[14]^l1[15]^l1[19] ^ k1[2]^k1[5]^k1[7]^k1[8]^k1[12]^k1[13]^k1[16]^k1[17]^k1[18]^k1[19];
-	s1[7]= l1[4]^l1[5]^l1[6]^l1[7]^l1[8]^l1[9]^l1[11]^l1[13]^l1[16]^l1[17] ^ k1[3]^k1[5]^k1[6]^k1[8]^k1[9]^k1[11]^k1[12]^k1[15]^k1[16]^k1[17];
-	s1[8]= l1[5]^l1[6]^l1[7]^l1[9]^l1[12]^l1[14]^l1[15]^l1[16]^l1[18]^l1[19] ^ k1[6]^k1[7]^k1[8]^k1[9]^k1[11]^k1[12]^k1[13]^k1[14]^k1[16]^k1[17];
-	s1[9]= l1[6]^l1[7]^l1[8]^l1[9]^l1[12]^l1[13]^l1[14]^l1[15]^l1[17]^l1[19] ^ k1[4]^k1[5]^k1[6]^k1[7]^k1[9]^k1[11]^k1[12]^k1[13]^k1[14]^k1[15];	
-	s1[10]= l1[7]^l1[8]^l1[9]^l1[10]^l1[11]^l1[13]^l1[14]^l1[15]^l1[16]^l1[17] ^ k1[10]^k1[11]^k1[12]^k1[13]^k1[14]^k1[15]^k1[16]^k1[17]^k1[18]^k1[19];
-        s1[11]= l1[8]^l1[9]^l1[10]^l1[11]^l1[12]^l1[13]^l1[14]^l1[15]^l1[16]^l1[17] ^ k1[0]^k1[3]^k1[5]^k1[7]^k1[9]^k1[12]^k1[13]^k1[16]^k1[17]^k1[19];
-        s1[12]= l1[9]^l1[10]^l1[11]^l1[12]^l1[13]^l1[14]^l1[15]^l1[16]^l1[17]^l1[18] ^ k1[0]^k1[1]^k1[2]^k1[3]^k1[4]^k1[5]^k1[8]^k1[9]^k1[11]^k1[13];
-        s1[13]= l1[3]^l1[5]^l1[7]^l1[8]^l1[9]^l1[10]^l1[13]^l1[14]^l1[16]^l1[18] ^ k1[0]^k1[1]^k1[2]^k1[4]^k1[7]^k1[9]^k1[11]^k1[12]^k1[13]^k1[17];
-        s1[14]= l1[1]^l1[3]^l1[7]^l1[9]^l1[11]^l1[13]^l1[14]^l1[15]^l1[18]^l1[19] ^ k1[2]^k1[4]^k1[6]^k1[7]^k1[8]^k1[11]^k1[13]^k1[15]^k1[17]^k1[18];
-        s1[15]= l1[8]^l1[9]^l1[10]^l1[11]^l1[13]^l1[14]^l1[16]^l1[17]^l1[18]^l1[19] ^ k1[3]^k1[4]^k1[5]^k1[7]^k1[9]^k1[12]^k1[13]^k1[14]^k1[16]^k1[17];
-        s1[16]= l1[1]^l1[3]^l1[6]^l1[7]^l1[8]^l1[9]^l1[11]^l1[14]^l1[15]^l1[16] ^ k1[2]^k1[3]^k1[7]^k1[8]^k1[12]^k1[14]^k1[16]^k1[17]^k1[18]^k1[19];
-        s1[17]= l1[4]^l1[5]^l1[6]^l1[7]^l1[8]^l1[9]^l1[14]^l1[15]^l1[16]^l1[19] ^ k1[3]^k1[4]^k1[6]^k1[8]^k1[9]^k1[10]^k1[12]^k1[13]^k1[16]^k1[17];
-        s1[18]= l1[5]^l1[6]^l1[7]^l1[8]^l1[12]^l1[14]^l1[15]^l1[16]^l1[18]^l1[19] ^ k1[6]^k1[7]^k1[8]^k1[9]^k1[10]^k1[11]^k1[13]^k1[14]^k1[16]^k1[17];
-        s1[19]= l1[6]^l1[7]^l1[8]^l1[9]^l1[11]^l1[12]^l1[14]^l1[15]^l1[17]^l1[18] ^ k1[4]^k1[5]^k1[6]^k1[8]^k1[9]^k1[11]^k1[12]^k1[14]^k1[15]^k1[18];
-
-
-	// first P-BOX		
-
-	y1[0] = s1[0];
-	y1[1] = s1[2];
-	y1[2] = s1[3];
-	y1[3] = s1[4];
-	y1[4] = s1[5];
-	y1[5] = s1[6];
-	y1[6] = s1[7];
-	y1[7] = s1[8];
-	y1[8] = s1[9];
-	y1[9] = s1[10];
-	y1[10] = s1[11];
-	y1[11] = s1[12];
-	y1[12] = s1[13];
-	y1[13] = s1[14];
-	y1[14] = s1[15];
-	y1[15] = s1[16];
-	y1[16] = s1[17];
-	y1[17] = s1[18];
-	y1[18] = s1[19];
-	y1[19] = s1[1];
-
-	// XOR Operation
-	 for (i=0;i<20;i++){
-		r2[i] = r1[i]^y1[i];   
-	}
-
-
-	////// ------- STAGE 2 ----------------------------------------------- ///
-
-	// Second  S-Box
-	s2[0]= r2[5]^r2[6]^r2[7]^r2[8]^r2[12]^r2[14]^r2[15]^r2[16]^r2[18]^r2[19] ^ k2[6]^k2[7]^k2[8]^k2[9]^k2[10]^k2[11]^k2[13]^k2[14]^k2[16]^k2[17];
-        s2[1]= r2[6]^r2[7]^r2[8]^r2[9]^r2[11]^r2[12]^r2[14]^r2[15]^r2[17]^r2[18] ^ k2[4]^k2[5]^k2[6]^k2[8]^k2[9]^k2[11]^k2[12]^k2[14]^k2[15]^k2[18];
-	s2[2]= r2[0]^r2[1]^r2[2]^r2[3]^r2[4]^r2[5]^r2[6]^r2[7]^r2[8]^r2[9] ^ k2[0]^k2[1]^k2[2]^k2[3]^k2[4]^k2[5]^k2[6]^k2[7]^k2[8]^k2[9];
-	s2[3]= r2[0]^r2[1]^r2[2]^r2[4]^r2[5]^r2[7]^r2[9]^r2[11]^r2[18]^r2[19] ^ k2[1]^k2[3]^k2[5]^k2[7]^k2[9]^k2[11]^k2[13]^k2[15]^k2[17]^k2[19];
-	s2[4]= r2[1]^r2[3]^r2[5]^r2[7]^r2[9]^r2[11]^r2[13]^r2[15]^r2[17]^r2[19] ^ k2[0]^k2[1]^k2[2]^k2[3]^k2[4]^k2[5]^k2[6]^k2[7]^k2[8]^k2[9];
-	s2[5]= r2[0]^r2[2]^r2[4]^r2[6]^r2[8]^r2[10]^r2[12]^r2[14]^r2[16]^r2[18] ^ k2[0]^k2[1]^k2[2]^k2[3]^k2[7]^k2[9]^k2[11]^k2[12]^k2[14]^k2[17];
-	s2[6]= r2[1]^r2[3]^r2[8]^r2[9]^r2[11]^r2[12]^r2[14]^r2[17]^r2[18]^r2[19] ^ k2[2]^k2[4]^k2[6]^k2[7]^k2[9]^k2[11]^k2[12]^k2[15]^k2[17]^k2[18];
-	s2[7]= r2[8]^r2[9]^r2[10]^r2[11]^r2[14]^r2[15]^r2[16]^r2[17]^r2[18]^r2[19] ^ k2[3]^k2[4]^k2[5]^k2[7]^k2[9]^k2[12]^k2[13]^k2[14]^k2[16]^k2[17];
-	s2[8]= r2[1]^r2[4]^r2[6]^r2[7]^r2[8]^r2[10]^r2[11]^r2[14]^r2[15]^r2[19] ^ k2[2]^k2[5]^k2[7]^k2[8]^k2[12]^k2[13]^k2[16]^k2[17]^k2[18]^k2[19];
-	s2[9]= r2[4]^r2[5]^r2[6]^r2[7]^r2[8]^r2[9]^r2[11]^r2[13]^r2[16]^r2[17] ^ k2[3]^k2[5]^k2[6]^k2[8]^k2[9]^k2[11]^k2[12]^k2[15]^k2[16]^k2[17];
-	s2[10]= r2[5]^r2[6]^r2[7]^r2[9]^r2[12]^r2[14]^r2[15]^r2[16]^r2[18]^r2[19] ^ k2[6]^k2[7]^k2[8]^k2[9]^k2[11]^k2[12]^k2[13]^k2[14]^k2[16]^k2[17];
-	s2[11]= r2[6]^r2[7]^r2[8]^r2[9]^r2[12]^r2[13]^r2[14]^r2[15]^r2[17]^r2[19] ^ k2[4]^k2[5]^k2[6]^k2[7]^k2[9]^k2[11]^k2[12]^k2[13]^k2[14]^k2[15];	
-	s2[12]= r2[7]^r2[8]^r2[9]^r2[10]^r2[11]^r2[13]^r2[14]^r2[15]^r2[16]^r2[17] ^ k2[10]^k2[11]^k2[12]^k2[13]^k2[14]^k2[15]^k2[16]^k2[17]^k2[18]^k2[19];
-        s2[13]= r2[8]^r2[9]^r2[10]^r2[11]^r2[12]^r2[13]^r2[14]^r2[15]^r2[16]^r2[17] ^ k2[0]^k2[3]^k2[5]^k2[7]^k2[9]^k2[12]^k2[13]^k2[16]^k2[17]^k2[19];
-        s2[14]= r2[9]^r2[10]^r2[11]^r2[12]^r2[13]^r2[14]^r2[15]^r2[16]^r2[17]^r2[18] ^ k2[0]^k2[1]^k2[2]^k2[3]^k2[4]^k2[5]^k2[8]^k2[9]^k2[11]^k2[13];
-        s2[15]= r2[3]^r2[5]^r2[7]^r2[8]^r2[9]^r2[10]^r2[13]^r2[14]^r2[16]^r2[18] ^ k2[0]^k2[1]^k2[2]^k2[4]^k2[7]^k2[9]^k2[11]^k2[12]^k2[13]^k2[17];
-        s2[16]= r2[1]^r2[3]^r2[7]^r2[9]^r2[11]^r2[13]^r2[14]^r2[15]^r2[18]^r2[19] ^ k2[2]^k2[4]^k2[6]^k2[7]^k2[8]^k2[11]^k2[13]^k2[15]^k2[17]^k2[18];
-        s2[17]= r2[8]^r2[9]^r2[10]^r2[11]^r2[13]^r2[14]^r2[16]^r2[17]^r2[18]^r2[19] ^ k2[3]^k2[4]^k2[5]^k2[7]^k2[9]^k2[12]^k2[13]^k2[14]^k2[16]^k2[17];
-        s2[18]= r2[1]^r2[3]^r2[6]^r2[7]^r2[8]^r2[9]^r2[11]^r2[14]^r2[15]^r2[16] ^ k2[2]^k2[3]^k2[7]^k2[8]^k2[12]^k2[14]^k2[16]^k2[17]^k2[18]^k2[19];
-        s2[19]= r2[4]^r2[5]^r2[6]^r2[7]^r2[8]^r2[9]^r2[14]^r2[15]^r2[16]^r2[19] ^ k2[3]^k2[4]^k2[6]^k2[8]^k2[9]^k2[10]^k2[12]^k2[13]^k2[16]^k2[17];
-	
-        // second  P-BOX
-
-        y2[0] = s2[2];
-        y2[1] = s2[3];
-        y2[2] = s2[4];
-        y2[3] = s2[5];
-        y2[4] = s2[6];
-        y2[5] = s2[7];
-        y2[6] = s2[8];
-        y2[7] = s2[9];
-        y2[8] = s2[10];
-        y2[9] = s2[11];
-        y2[10] = s2[12];
-        y2[11] = s2[13];
-        y2[12] = s2[14];
-        y2[13] = s2[15];
-        y2[14] = s2[16];
-        y2[15] = s2[17];
-        y2[16] = s2[18];
-        y2[17] = s2[19];
-        y2[18] = s2[1];
-        y2[19] = s2[2];
-        
-	 // XOR Operation
-         for (i=0;i<20;i++){
-                l2[i] = l1[i]^y2[i];
-        }
 
-	////// ------- STAGE 3 ----------------------------------------------- ///
-
-	// third S-Box
-	s3[0]= l2[8]^l2[9]^l2[10]^l2[11]^l2[13]^l2[14]^l2[16]^l2[17]^l2[18]^l2[19] ^ k3[3]^k3[4]^k3[5]^k3[7]^k3[9]^k3[12]^k3[13]^k3[14]^k3[16]^k3[17];
-    	s3[1]= l2[1]^l2[3]^l2[6]^l2[7]^l2[8]^l2[9]^l2[11]^l2[14]^l2[15]^l2[16] ^ k3[2]^k3[3]^k3[7]^k3[8]^k3[12]^k3[14]^k3[16]^k3[17]^k3[18]^k3[19];
-	s3[2]= l2[4]^l2[5]^l2[6]^l2[7]^l2[8]^l2[9]^l2[14]^l2[15]^l2[16]^l2[19] ^ k3[3]^k3[4]^k3[6]^k3[8]^k3[9]^k3[10]^k3[12]^k3[13]^k3[16]^k3[17];
-	s3[3]= l2[5]^l2[6]^l2[7]^l2[8]^l2[12]^l2[14]^l2[15]^l2[16]^l2[18]^l2[19] ^ k3[6]^k3[7]^k3[8]^k3[9]^k3[10]^k3[11]^k3[13]^k3[14]^k3[16]^k3[17];
-        s3[4]= l2[6]^l2[7]^l2[8]^l2[9]^l2[11]^l2[12]^l2[14]^l2[15]^l2[17]^l2[18] ^ k3[4]^k3[5]^k3[6]^k3[8]^k3[9]^k3[11]^k3[12]^k3[14]^k3[15]^k3[18];
-	s3[5]= l2[0]^l2[1]^l2[2]^l2[3]^l2[4]^l2[5]^l2[6]^l2[7]^l2[8]^l2[9] ^ k3[0]^k3[1]^k3[2]^k3[3]^k3[4]^k3[5]^k3[6]^k3[7]^k3[8]^k3[9];
-	s3[6]= l2[0]^l2[1]^l2[2]^l2[4]^l2[5]^l2[7]^l2[9]^l2[11]^l2[18]^l2[19] ^ k3[1]^k3[3]^k3[5]^k3[7]^k3[9]^k3[11]^k3[13]^k3[15]^k3[17]^k3[19];
-	s3[7]= l2[1]^l2[3]^l2[5]^l2[7]^l2[9]^l2[11]^l2[13]^l2[15]^l2[17]^l2[19] ^ k3[0]^k3[1]^k3[2]^k3[3]^k3[4]^k3[5]^k3[6]^k3[7]^k3[8]^k3[9];
-	s3[8]= l2[0]^l2[2]^l2[4]^l2[6]^l2[8]^l2[10]^l2[12]^l2[14]^l2[16]^l2[18] ^ k3[0]^k3[1]^k3[2]^k3[3]^k3[7]^k3[9]^k3[11]^k3[12]^k3[14]^k3[17];
-	s3[9]= l2[1]^l2[3]^l2[8]^l2[9]^l2[11]^l2[12]^l2[14]^l2[17]^l2[18]^l2[19] ^ k3[2]^k3[4]^k3[6]^k3[7]^k3[9]^k3[11]^k3[12]^k3[15]^k3[17]^k3[18];
-	s3[10]= l2[8]^l2[9]^l2[10]^l2[11]^l2[14]^l2[15]^l2[16]^l2[17]^l2[18]^l2[19] ^ k3[3]^k3[4]^k3[5]^k3[7]^k3[9]^k3[12]^k3[13]^k3[14]^k3[16]^k3[17];
-	s3[11]= l2[1]^l2[4]^l2[6]^l2[7]^l2[8]^l2[10]^l2[11]^l2[14]^l2[15]^l2[19] ^ k3[2]^k3[5]^k3[7]^k3[8]^k3[12]^k3[13]^k3[16]^k3[17]^k3[18]^k3[19];
-	s3[12]= l2[4]^l2[5]^l2[6]^l2[7]^l2[8]^l2[9]^l2[11]^l2[13]^l2[16]^l2[17] ^ k3[3]^k3[5]^k3[6]^k3[8]^k3[9]^k3[11]^k3[12]^k3[15]^k3[16]^k3[17];
-	s3[13]= l2[5]^l2[6]^l2[7]^l2[9]^l2[12]^l2[14]^l2[15]^l2[16]^l2[18]^l2[19] ^ k3[6]^k3[7]^k3[8]^k3[9]^k3[11]^k3[12]^k3[13]^k3[14]^k3[16]^k3[17];
-	s3[14]= l2[6]^l2[7]^l2[8]^l2[9]^l2[12]^l2[13]^l2[14]^l2[15]^l2[17]^l2[19] ^ k3[4]^k3[5]^k3[6]^k3[7]^k3[9]^k3[11]^k3[12]^k3[13]^k3[14]^k3[15];	
-	s3[15]= l2[7]^l2[8]^l2[9]^l2[10]^l2[11]^l2[13]^l2[14]^l2[15]^l2[16]^l2[17] ^ k3[10]^k3[11]^k3[12]^k3[13]^k3[14]^k3[15]^k3[16]^k3[17]^k3[18]^k3[19];
-        s3[16]= l2[8]^l2[9]^l2[10]^l2[11]^l2[12]^l2[13]^l2[14]^l2[15]^l2[16]^l2[17] ^ k3[0]^k3[3]^k3[5]^k3[7]^k3[9]^k3[12]^k3[13]^k3[16]^k3[17]^k3[19];
-        s3[17]= l2[9]^l2[10]^l2[11]^l2[12]^l2[13]^l2[14]^l2[15]^l2[16]^l2[17]^l2[18] ^ k3[0]^k3[1]^k3[2]^k3[3]^k3[4]^k3[5]^k3[8]^k3[9]^k3[11]^k3[13];
-        s3[18]= l2[3]^l2[5]^l2[7]^l2[8]^l2[9]^l2[10]^l2[13]^l2[14]^l2[16]^l2[18] ^ k3[0]^k3[1]^k3[2]^k3[4]^k3[7]^k3[9]^k3[11]^k3[12]^k3[13]^k3[17];
-        s3[19]= l2[1]^l2[3]^l2[7]^l2[9]^l2[11]^l2[13]^l2[14]^l2[15]^l2[18]^l2[19] ^ k3[2]^k3[4]^k3[6]^k3[7]^k3[8]^k3[11]^k3[13]^k3[15]^k3[17]^k3[18];
-          
-	// third  P-BOX
-        y3[0] = s3[10];
-        y3[1] = s3[11];
-        y3[2] = s3[12];
-        y3[3] = s3[13];
-        y3[4] = s3[14];
-        y3[5] = s3[15];
-        y3[6] = s3[16];
-        y3[7] = s3[17];
-        y3[8] = s3[18];
-        y3[9] = s3[0];
-        y3[10] = s3[1];
-        y3[11] = s3[2];
-        y3[12] = s3[3];
-        y3[13] = s3[4];
-        y3[14] = s3[5];
-        y3[15] = s3[6];
-        y3[16] = s3[7];
-        y3[17] = s3[8];
-        y3[18] = s3[9];
-        y3[19] = s3[19];
-
-	 // XOR Operation
-         for (i=0;i<20;i++){
-                l3[i] = r2[i]^y3[i];
-        }
+// Set index mapping schemes.  Each map_* function returns the set number of the
+// line address a for the cache described by map; init_map picks the function of
+// a scheme once per cache, along with the set bits, masks and keys it uses.
+//	0 modulo, 1 rotate right by 3, 2 tag XOR set, 3 rotate right by 1 and XOR tag,
+//	4 middle of squared tag XOR set, 5 odd multiplier (7), 6 Intel slice hash,
+//	7 DES, 8 CEASER, 9 tag permutation XOR set
+static int32_t map_modulo(set_map *map, uint64_t a){
+	return (int32_t) (a & map->set_mask);
+}
 
+static int32_t map_rotate(set_map *map, uint64_t a){
+	return (int32_t) rotr(a & map->set_mask, map->set_bits, 3);
+}
 
-	////// ------- STAGE 4 ----------------------------------------------- ///
-
-	// fourth S-Box
-	s4[0]= l3[1]^l3[3]^l3[7]^l3[9]^l3[11]^l3[13]^l3[14]^l3[15]^l3[18]^l3[19] ^ k4[2]^k4[4]^k4[6]^k4[7]^k4[8]^k4[11]^k4[13]^k4[15]^k4[17]^k4[18];
-  	s4[1]= l3[8]^l3[9]^l3[10]^l3[11]^l3[13]^l3[14]^l3[16]^l3[17]^l3[18]^l3[19] ^ k4[3]^k4[4]^k4[5]^k4[7]^k4[9]^k4[12]^k4[13]^k4[14]^k4[16]^k4[17];
-        s4[3]= l3[1]^l3[3]^l3[6]^l3[7]^l3[8]^l3[9]^l3[11]^l3[14]^l3[15]^l3[16] ^ k4[2]^k4[3]^k4[7]^k4[8]^k4[12]^k4[14]^k4[16]^k4[17]^k4[18]^k4[19];
-        s4[3]= l3[4]^l3[5]^l3[6]^l3[7]^l3[8]^l3[9]^l3[14]^l3[15]^l3[16]^l3[19] ^ k4[3]^k4[4]^k4[6]^k4[8]^k4[9]^k4[10]^k4[12]^k4[13]^k4[16]^k4[17];
-        s4[4]= l3[5]^l3[6]^l3[7]^l3[8]^l3[12]^l3[14]^l3[15]^l3[16]^l3[18]^l3[19] ^ k4[6]^k4[7]^k4[8]^k4[9]^k4[10]^k4[11]^k4[13]^k4[14]^k4[16]^k4[17];
-        s4[5]= l3[6]^l3[7]^l3[8]^l3[9]^l3[11]^l3[12]^l3[14]^l3[15]^l3[17]^l3[18] ^ k4[4]^k4[5]^k4[6]^k4[8]^k4[9]^k4[11]^k4[12]^k4[14]^k4[15]^k4[18];
-	s4[6]= l3[0]^l3[1]^l3[2]^l3[3]^l3[4]^l3[5]^l3[6]^l3[7]^l3[8]^l3[9] ^ k4[0]^k4[1]^k4[2]^k4[3]^k4[4]^k4[5]^k4[6]^k4[7]^k4[8]^k4[9];
-	s4[7]= l3[0]^l3[1]^l3[2]^l3[4]^l3[5]^l3[7]^l3[9]^l3[11]^l3[18]^l3[19] ^ k4[1]^k4[3]^k4[5]^k4[7]^k4[9]^k4[11]^k4[13]^k4[15]^k4[17]^k4[19];
-	s4[8]= l3[1]^l3[3]^l3[5]^l3[7]^l3[9]^l3[11]^l3[13]^l3[15]^l3[17]^l3[19] ^ k4[0]^k4[1]^k4[2]^k4[3]^k4[4]^k4[5]^k4[6]^k4[7]^k4[8]^k4[9];
-	s4[9]= l3[0]^l3[2]^l3[4]^l3[6]^l3[8]^l3[10]^l3[12]^l3[14]^l3[16]^l3[18] ^ k4[0]^k4[1]^k4[2]^k4[3]^k4[7]^k4[9]^k4[11]^k4[12]^k4[14]^k4[17];
-	s4[10]= l3[1]^l3[3]^l3[8]^l3[9]^l3[11]^l3[12]^l3[14]^l3[17]^l3[18]^l3[19] ^ k4[2]^k4[4]^k4[6]^k4[7]^k4[9]^k4[11]^k4[12]^k4[15]^k4[17]^k4[18];
-	s4[11]= l3[8]^l3[9]^l3[10]^l3[11]^l3[14]^l3[15]^l3[16]^l3[17]^l3[18]^l3[19] ^ k4[3]^k4[4]^k4[5]^k4[7]^k4[9]^k4[12]^k4[13]^k4[14]^k4[16]^k4[17];
-	s4[12]= l3[1]^l3[4]^l3[6]^l3[7]^l3[8]^l3[10]^l3[11]^l3[14]^l3[15]^l3[19] ^ k4[2]^k4[5]^k4[7]^k4[8]^k4[12]^k4[13]^k4[16]^k4[17]^k4[18]^k4[19];
-	s4[13]= l3[4]^l3[5]^l3[6]^l3[7]^l3[8]^l3[9]^l3[11]^l3[13]^l3[16]^l3[17] ^ k4[3]^k4[5]^k4[6]^k4[8]^k4[9]^k4[11]^k4[12]^k4[15]^k4[16]^k4[17];
-	s4[14]= l3[5]^l3[6]^l3[7]^l3[9]^l3[12]^l3[14]^l3[15]^l3[16]^l3[18]^l3[19] ^ k4[6]^k4[7]^k4[8]^k4[9]^k4[11]^k4[12]^k4[13]^k4[14]^k4[16]^k4[17];
-	s4[15]= l3[6]^l3[7]^l3[8]^l3[9]^l3[12]^l3[13]^l3[14]^l3[15]^l3[17]^l3[19] ^ k4[4]^k4[5]^k4[6]^k4[7]^k4[9]^k4[11]^k4[12]^k4[13]^k4[14]^k4[15];	
-	s4[16]= l3[7]^l3[8]^l3[9]^l3[10]^l3[11]^l3[13]^l3[14]^l3[15]^l3[16]^l3[17] ^ k4[10]^k4[11]^k4[12]^k4[13]^k4[14]^k4[15]^k4[16]^k4[17]^k4[18]^k4[19];
-        s4[17]= l3[8]^l3[9]^l3[10]^l3[11]^l3[12]^l3[13]^l3[14]^l3[15]^l3[16]^l3[17] ^ k4[0]^k4[3]^k4[5]^k4[7]^k4[9]^k4[12]^k4[13]^k4[16]^k4[17]^k4[19];
-        s4[18]= l3[9]^l3[10]^l3[11]^l3[12]^l3[13]^l3[14]^l3[15]^l3[16]^l3[17]^l3[18] ^ k4[0]^k4[1]^k4[2]^k4[3]^k4[4]^k4[5]^k4[8]^k4[9]^k4[11]^k4[13];
-        s4[19]= l3[3]^l3[5]^l3[7]^l3[8]^l3[9]^l3[10]^l3[13]^l3[14]^l3[16]^l3[18] ^ k4[0]^k4[1]^k4[2]^k4[4]^k4[7]^k4[9]^k4[11]^k4[12]^k4[13]^k4[17];
-   
-	// fourth  P-BOX
-
-        y4[0] = s4[4];
-        y4[1] = s4[5];
-        y4[2] = s4[6];
-        y4[3] = s4[7];
-        y4[4] = s4[8];
-        y4[5] = s4[9];
-        y4[6] = s4[10];
-        y4[7] = s4[11];
-        y4[8] = s4[12];
-        y4[9] = s4[13];
-        y4[10] = s4[14];
-        y4[11] = s4[15];
-        y4[12] = s4[16];
-        y4[13] = s4[17];
-        y4[14] = s4[18];
-        y4[15] = s4[19];
-        y4[16] = s4[0];
-        y4[17] = s4[1];
-        y4[18] = s4[2];
-        y4[19] = s4[3];
-
-	 // XOR Operation
-         for (i=0;i<20;i++){
-                r3[i] = l2[i]^y4[i];
-        }
+static int32_t map_tag_xor(set_map *map, uint64_t a){
+	return (int32_t) ((a ^ (a >> map->set_bits)) & map->set_mask);
+}
 
-       // printf("%lld ,%lld \n",R,L);
-/*
-        for (i=0;i<20;i++){
-                printf("%d",r3[i]);
-        }
-        printf("\n");
-*/
+static int32_t map_rotate_xor(set_map *map, uint64_t a){
+	uint64_t tag_part = (a >> map->set_bits) & map->set_mask;
+	return (int32_t) (rotr(a & map->set_mask, map->set_bits, 1) ^ tag_part);
+}
 
-	// Generate the final address with l3 and r3 as L' and R' respectively
-	 for (i=0;i<20;i++){
-		final_L += l3[i] << i; 		
-		final_R += r3[i] << i;
-	}
-	final_a = (final_L << 20) |  final_R;
-		
-//	printf("%lld , %lld \n",a, final_a);
+// the tag part has at most 26 bits, so its square is exact in 64 bits
+static int32_t map_square(set_map *map, uint64_t a){
+	uint64_t tag_part = (a >> map->set_bits) & map->set_mask;
+	tag_part = ((tag_part * tag_part) >> map->shift) & map->set_mask;
+	return (int32_t) ((a & map->set_mask) ^ tag_part);
+}
 
-	return final_a;		
+static int32_t map_odd_mult(set_map *map, uint64_t a){
+	uint64_t tag_part = (a >> map->set_bits) & map->set_mask;
+	return (int32_t) ((7*tag_part + a) & map->set_mask);
 }
 
-uint64_t permutation_tag (uint64_t tag, unsigned int set_bits){
-	int i, j;
-	int tag_part[set_bits];
-        int p_tag_part[set_bits];
-	uint64_t permuted_tag =0;
+static int32_t map_slice(set_map *map, uint64_t a){
+	return (int32_t) ((a & map->low_mask) | ((uint64_t) intel_slide_case(a) << map->shift));
+}
 
-	for (i=0;i<set_bits;i++){
-               tag_part[i] =tag>>i & 0x1;
-	}
+static int32_t map_des(set_map *map, uint64_t a){
+	return (int32_t) (des(a, des_key, 'e') & map->set_mask);
+}
 
-	// Permutation of bits
+static int32_t map_ceaser(set_map *map, uint64_t a){
+	uint64_t new_address = (a & 0xFFFFFFFFFF);  // select 40 bits address
+	return (int32_t) (ceaser_address(new_address, map->key[0], map->key[1], map->key[2], map->key[3]) & map->set_mask);
+}
 
-	p_tag_part[0] = tag_part[0];
-	for (i=1;i<set_bits-1;i++){
-		p_tag_part[i] = tag_part[i+1];
-	}
-	p_tag_part[set_bits-1] = tag_part[1];
+// the tag permutation keeps tag bit 0, moves bits 2..n-1 down by one and bit 1 to the top
+static int32_t map_permute(set_map *map, uint64_t a){
+	uint64_t tag_part = (a >> map->set_bits) & map->set_mask;
+	uint64_t permuted_tag = (tag_part & 1) | ((tag_part >> 1) & map->low_mask)
+			| (((tag_part >> 1) & 1) << map->shift);
+	return (int32_t) ((a & map->set_mask) ^ permuted_tag);
+}
 
+// memo lookup in front of the cipher schemes; calc computes the set of a new line
+static int32_t map_memo_fn(set_map *map, uint64_t a){
+	map_memo *m = &map->memo[a & (MAP_MEMO-1)];
 
-	for (i=0;i<set_bits;i++){
-		permuted_tag += p_tag_part[i] << i; 		
+	if (m->line != a  ||  m->epoch != map_epoch){
+		m->line = a;
+		m->set = map->calc(map, a);
+		m->epoch = map_epoch;
 	}
-	return permuted_tag;
+	return m->set;
 }
 
 
-uint64_t permutation_set (uint32_t set, unsigned int set_bits){
-	int i, j;
-	int set_part[set_bits];
-        int p_set_part[set_bits];
-	uint32_t permuted_set =0;
+void init_map(set_map *map, int32_t scheme, int32_t nmbr_sets){
+	int set_bits = 0;
 
-	for (i=0;i<set_bits;i++){
-               set_part[i] = set>>i & 0x1;
+	while ((1 << (set_bits + 1)) <= nmbr_sets) {
+		set_bits++;
 	}
-
-	// Permutation of bits
-
-	p_set_part[0] = set_part[0];
-	for (i=1;i<set_bits-1;i++){
-		p_set_part[i] = set_part[i+1];
+	map->scheme = scheme;
+	map->nmbr_sets = nmbr_sets;
+	map->set_bits = set_bits;
+	map->set_mask = ((uint64_t) 1 << set_bits) - 1;
+	map->low_mask = 0;
+	map->shift = 0;
+	map->key[0] = 0xababa;  // CEASER keys in total 80 bits (20 each)
+	map->key[1] = 0xcdcdc;
+	map->key[2] = 0xbabab;
+	map->key[3] = 0xdcdcd;
+
+	switch (scheme){
+		case 1:  map->fn = map_rotate;      break;
+		case 2:  map->fn = map_tag_xor;     break;
+		case 3:  map->fn = map_rotate_xor;  break;
+		case 4:
+			map->fn = map_square;
+			map->shift = set_bits/2;
+			break;
+		case 5:  map->fn = map_odd_mult;    break;
+		case 6:
+			map->fn = map_slice;
+			map->shift = set_bits - 3;
+			map->low_mask = ((uint64_t) 1 << map->shift) - 1;
+			break;
+		case 7:  map->fn = map_des;         break;
+		case 8:
+			map->fn = map_ceaser;
+			map_ceaser(map, 0);   // build the tables before any -schemes worker can use them
+			break;
+		case 9:
+			map->fn = map_permute;
+			map->shift = set_bits - 1;
+			map->low_mask = map->set_mask >> 1 & ~(uint64_t) 1;
+			if (set_bits < 2) {
+				map->fn = map_modulo;   // the permuted tag of 1 set bit is always 0
+			}
+			break;
+		default: map->fn = map_modulo;      break;
 	}
-	p_set_part[set_bits-1] = set_part[1];
 
-
-	for (i=0;i<set_bits;i++){
-		permuted_set += p_set_part[i] << i; 		
+	// DES costs far more than a memo lookup (CEASER is a few table lookups and scheme 9
+	// a few shifts, so they gain nothing); without memory DES is used directly
+	map->calc = map->fn;
+	if (scheme == 7){
+		if (map->memo == NULL){
+			map->memo = calloc(MAP_MEMO, sizeof(map_memo));
+		} else {
+			memset(map->memo, 0, MAP_MEMO * sizeof(map_memo));
+		}
+		if (map->memo != NULL){
+			map->fn = map_memo_fn;
+		}
 	}
-	return permuted_set;
 }
 
-
-int compute_set(uint64_t a, int scheme, int set_lines){  
-	  int i;
-	  int set;
-          int new_set;
-//        int set_lines = pow(2.0,SET_BITS);
-          int set_bits = log2(set_lines); 
-//	  printf("Set bits : %lld\n",a );
-          uint64_t tag_part;
-	  uint64_t permuted_tag;
-	  uint64_t tag;
-	  uint64_t des_input;
-//        uint64_t des_key = 0x0000000000000000;
-          uint64_t des_result = 0x0000000000000000;
-	  uint64_t square_tag;
-          int length;
-	  char str[set_bits];
-	  set = a & (set_lines-1);
-	  uint64_t new_address;
-          uint64_t cipher_address;
-          uint32_t k1,k2,k3,k4;  // CEASER keys in total 80 bits (20 each)
-          k1 = 0xababa;
-          k2 = 0xcdcdc;
-          k3 = 0xbabab;
-          k4 = 0xdcdcd;
-
-//	  printf("set inside: %d\n", set);
-
-	 // unsigned char hash[SHA_DIGEST_LENGTH];
-          switch (scheme){
-		case 0:  	// Mosule scheme
-            		return (int) ( set );
-	  	break;
-		case 1:       // Rotate Right by 3
-                        set = rotr(set,set_bits,3);
-                        return ( set);
-                break;
-               case 2:         //  TAG XOR SET
-                        tag_part = (a >> set_bits ) & (set_lines-1);
-                        return ( set ^ tag_part);
-                break;
-		case 3:       // Rotate Right by 1 & XOR
-                        set = rotr(set,set_bits,1);
-                        tag_part = (a >> set_bits ) & (set_lines-1);
-                        return ( set ^ tag_part);
-                break;
-		case 4:   // Square TAG ( select midle part) XOR with set
-			tag_part = (a >> set_bits ) & (set_lines-1);                     
-			square_tag = pow(tag_part,2.0);
-			tag_part =  square_tag >> ( (int) set_bits/2);
-			tag_part = tag_part & (set_lines-1);
-			return ( set ^ tag_part);
-		break;
-		case 5: // Odd multiplier (by 7 )
-                        tag_part = (a >> set_bits ) & (set_lines-1);
-			set  = (7*tag_part+set)%set_lines; 
-			return ( set );
-                break;
-		case 6: // Case of Intel slide Cache
-			new_set = (set & ((1<< set_bits-3)-1)) | ( intel_slide_case(a) <<(set_bits-3) ); 
-                        return( new_set);
-                break;
-		case 7: // DES
-                        des_input = a;
-			des_result = des(des_input, des_key, 'e');
-			new_set = des_result %set_lines;
-			return(new_set);
-		break;
-	
-		case 8: // CEASER implementation 
-			//uint64_t new_address;
-			//uint64_t cipher_address;
-			//uint32_t k1,k2,k3,k4;
-                        new_address = (a & 0xFFFFFFFFFF);  // select 40 bits address
-                        cipher_address= ceaser_address(new_address,k1,k2,k3,k4);
-		        //printf("%ld  %d  %d  %d \n", a, set_lines,  set, cipher_address & (set_lines-1) ); 
-			return (int) (cipher_address & (set_lines-1) );
-                break;
-
-		
-		case 9: // TAG PERMUTATION and later XOR SET
-			//int p_tag_part[set_bits];
-			//uint64_t permuted_tag;
-			tag_part = (a >> set_bits ) & (set_lines-1);
-			permuted_tag = permutation_tag(tag_part,set_bits);
-                        return ( set ^ permuted_tag);
-                break;
-
-
-/*
-		case 10: // SHA1
-			length = set_bits;
-			sprintf(str, "%d", set); // convert integer to String
-                       // SHA1(set, length, hash);  // my hash  has 160 bits
-		//	new_set =  ( hash[18]<<8 || hash[19] ) & ((1<< set_bits)-1)  ;
-		//	return( new_set );
-
-                break;
-*/	
-
-	  }
-}
-
-
-double corr(struct sets mysets, int bit1pos, int bit2pos )  {
+double corr(struct sets *mysets, int bit1pos, int bit2pos )  {
    double corr;
    uint64_t a,b,c,d;
    // minim numerator
-   a = mysets.sum_S[bit1pos][bit2pos];
-   b = mysets.sum_D[bit1pos][bit2pos];
+   a = mysets->sum_S[bit1pos][bit2pos];
+   b = mysets->sum_D[bit1pos][bit2pos];
    c = (a>b)? b:a; // minimum
    d = (a>b)? a:b; // maximum   
    corr = 1 -(double)((double)c/(double)d);
@@ -585,109 +397,261 @@ double corr(struct sets mysets, int bit1pos, int bit2pos )  {
 }
 
 
-void estimatePs(struct sets *mysets, uint64_t a ){
+// grow_sets makes mysets hold at least set_lines zeroed sets.  The leakage state
+// is only allocated once -csvfile2 output sees its first access, and is sized to
+// the nmbr_sets of the cache_test cache.
+void grow_sets(int set_lines){
 
-      int nbit;
-      int i, j;
-      int temp_nbits[42];
-      for(nbit=0;nbit<42;nbit++){
-         // calcule if bit nbit is 0 or 1
-         if ((a >> nbit)& 0x1){  // if is 1
-//	      printf("1");
-                mysets->p1[nbit]=1;
-                mysets->num_1[nbit] = mysets->num_1[nbit]+ 1;
-                temp_nbits[nbit]=1;
-                
-          } else {   // is 0
-//             printf("0");
-               mysets->p1[nbit]=0;
-	       temp_nbits[nbit]=0;
-          }
+      mysets = realloc(mysets, set_lines * sizeof(struct sets));
+      if (mysets == NULL){
+	error("Unable to allocate memory for the set leakage statistics", -10);
       }
-      mysets->elements = mysets->elements + 1;   // add an element
+      memset(&mysets[nmbr_mysets], 0, (set_lines - nmbr_mysets) * sizeof(struct sets));
+      nmbr_mysets = set_lines;
+  return;
+}
 
-      /// Calculate the correlation formula
+
+// The per-set bit statistics are accumulated 64 addresses at a time.  estimatePs
+// only records the address bits in bit slices: bit k of slice[nbit] is bit nbit of
+// the k-th buffered address.  flushPs then adds the buffered addresses to num_1 and
+// to sum_S/sum_D, where sum_D[i][j] counts the addresses whose bits i and j differ,
+// which is the popcount of slice[i] ^ slice[j].
+void flushPs(struct sets *mysets){
+
+      int i, j;
+      uint32_t d;
+
+      if (mysets->nbuf == 0) return;
       for (i=0; i<42; i++){
-	for (j=0; j<42; j++){
-		if (temp_nbits[i]^temp_nbits[j]){  // XOR , if is 10 or 01
-			mysets->sum_D[i][j]+=1;
-		} else {                          // if is 11 or 00
-			mysets->sum_S[i][j]+=1;		
-		}
+	mysets->num_1[i] += __builtin_popcountll(mysets->slice[i]);
+	mysets->sum_S[i][i] += mysets->nbuf;
+	for (j=0; j<i; j++){
+		d = __builtin_popcountll(mysets->slice[i] ^ mysets->slice[j]);
+		mysets->sum_D[i][j] += d;
+		mysets->sum_D[j][i] += d;
+		mysets->sum_S[i][j] += mysets->nbuf - d;
+		mysets->sum_S[j][i] += mysets->nbuf - d;
 	}
       }
+      for (i=0; i<42; i++){
+	mysets->slice[i] = 0;
+      }
+      mysets->nbuf = 0;
+  return;
+}
 
 
+void estimatePs(struct sets *mysets, uint64_t a ){
+
+      uint64_t bits;
+      uint64_t k;
+
+      k = 1ULL << mysets->nbuf;
+      bits = a & ((1ULL << 42) - 1);
+      while (bits){                 // set bit k of the slice of each 1 bit of a
+	mysets->slice[__builtin_ctzll(bits)] |= k;
+	bits &= bits - 1;
+      }
+      mysets->elements = mysets->elements + 1;   // add an element
+      if (++mysets->nbuf == 64){
+	flushPs(mysets);
+      }
+
   return;
 }
 
 
 
-void compute_entropies(struct sets *mysets, int set_lines){
-	int s=0, nbit=0;
-	int i, j;
-        double p1;
-	int set_bits = log2(set_lines);
+// compute_entropies and print_results handle each set on its own, so the sets are
+// split into ranges (set_part) that are processed by up to SET_THREADS threads.
+// print_results formats the lines of each range into memory in its thread and
+// writes the ranges in set order, so the files do not depend on the thread count.
+#define SET_THREADS 16        // most threads used for the per-set results
+#define SET_MIN_PART 256      // fewest sets given to a thread
+
+typedef struct out_buf_rec {
+   char *p;                   // formatted text
+   size_t len;                // number of characters in p
+   size_t max;                // bytes allocated for p
+} out_buf;
+
+typedef struct set_part_rec set_part;
+struct set_part_rec {
+   void (*fn)(set_part *);    // work done on the sets of this part
+   struct sets *mysets;       // all of the sets
+   int first;                 // first set of this part
+   int last;                  // one past the last set of this part
+   int set_bits;              // log 2 of the number of sets
+   uint64_t elements_sum;     // addresses in all of the sets (print_results)
+   out_buf avg;               // Results_average_* lines of the sets (print_results)
+   out_buf by_set;            // Results_by_set_* lines of the sets (print_results)
+};
+
+
+// ob_grow makes room for need more characters in ob
+static void ob_grow(out_buf *ob, size_t need){
+   if (ob->max - ob->len >= need) return;
+   while (ob->max - ob->len < need){
+      ob->max = ob->max ? 2*ob->max : 65536;
+   }
+   ob->p = realloc(ob->p, ob->max);
+   if (ob->p == NULL){
+      error("Unable to allocate memory for the results text", -10);
+   }
+}
+
+
+// ob_printf appends printf formatted text to ob
+static void ob_printf(out_buf *ob, const char *fmt, ...){
+   va_list ap;
+   int n;
+
+   ob_grow(ob, 256);
+   va_start(ap, fmt);
+   n = vsnprintf(ob->p + ob->len, ob->max - ob->len, fmt, ap);
+   va_end(ap);
+   if ((size_t) n >= ob->max - ob->len){      // did not fit, grow and format again
+      ob_grow(ob, n + 1);
+      va_start(ap, fmt);
+      vsnprintf(ob->p + ob->len, ob->max - ob->len, fmt, ap);
+      va_end(ap);
+   }
+   ob->len += n;
+}
+
+
+static void *set_part_thread(void *arg){
+   set_part *part = (set_part *) arg;
+
+   part->fn(part);
+   return NULL;
+}
+
+
+// set_parts_run splits the set_lines sets into parts and runs fn on each part in
+// its own thread, returns the number of parts
+static int set_parts_run(set_part *parts, void (*fn)(set_part *), struct sets *mysets,
+                         int set_lines, int set_bits, uint64_t elements_sum){
+   pthread_t threads[SET_THREADS];
+   int started[SET_THREADS];
+   long ncpu;
+   int nparts, k;
+
+   ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+   nparts = set_lines / SET_MIN_PART;
+   if (nparts > ncpu) nparts = ncpu;
+   if (nparts > SET_THREADS) nparts = SET_THREADS;
+   if (nparts < 1) nparts = 1;
+   for (k=0;k<nparts;k++){
+      memset(&parts[k], 0, sizeof(set_part));
+      parts[k].fn = fn;
+      parts[k].mysets = mysets;
+      parts[k].first = (int) ((int64_t) set_lines * k / nparts);
+      parts[k].last = (int) ((int64_t) set_lines * (k+1) / nparts);
+      parts[k].set_bits = set_bits;
+      parts[k].elements_sum = elements_sum;
+   }
+   for (k=1;k<nparts;k++){
+      started[k] = (pthread_create(&threads[k], NULL, set_part_thread, &parts[k]) == 0);
+      if (!started[k]) fn(&parts[k]);     // no thread, do it here
+   }
+   fn(&parts[0]);
+   for (k=1;k<nparts;k++){
+      if (started[k]) pthread_join(threads[k], NULL);
+   }
+   return nparts;
+}
+
+
+static void entropy_part(set_part *part){
+	struct sets *ms;
+	int s, nbit, i;
+	double p1, h;
+	double corr_temp, corr_max;
+
 	//calculate the p[i] for each set
-	for(s=0; s<set_lines ;s++){
-		for (nbit=0;nbit<42; nbit++){				
-			if (mysets[s].elements ==0) {
-				mysets[s].p1[nbit]= 0;
+	for(s=part->first; s<part->last ;s++){
+		ms = &part->mysets[s];
+		flushPs(ms);		// add the addresses still buffered
+		for (nbit=0;nbit<42; nbit++){
+			if (ms->elements ==0) {
+				ms->p1[nbit]= 0;
 		        } else {
-				mysets[s].p1[nbit]=  (double) mysets[s].num_1[nbit]/(double) mysets[s].elements;
+				ms->p1[nbit]=  (double) ms->num_1[nbit]/(double) ms->elements;
 			}
-			p1 = mysets[s].p1[nbit];
-			// printf("For s = %d  p1[%d] = %f \n", s, nbit, p1);
+			p1 = ms->p1[nbit];
 			if ((p1 != 1.0) && (p1 != 0.0) ){
-			     // calculate info leakage by bit in this set
-			     mysets[s].info_bit[nbit]= 1 - fabs( p1* log2(p1) + (1.0-p1)* log2(1.0-p1));	
-
-			     // Calculate the total entropy 
-		             mysets[s].info += fabs( p1* log2(p1) + (1.0-p1)* log2(1.0-p1) ) ;
-
-			     if (nbit < set_bits ) {
-			        mysets[s].set_index_info += fabs( p1* log2(p1) + (1.0-p1)* log2(1.0-p1) ) ;
+			     // entropy of the bit, used for the info leakage by bit and the totals
+			     h = fabs( p1* log2(p1) + (1.0-p1)* log2(1.0-p1) );
+			     ms->info_bit[nbit]= 1 - h;
+			     ms->info += h;
+			     if (nbit < part->set_bits ) {
+			        ms->set_index_info += h;
 			     } else {
-			        mysets[s].tag_info += fabs( p1* log2(p1) + (1.0-p1)* log2(1.0-p1) ) ;
-                             }
-
+			        ms->tag_info += h;
+			     }
 			} else {  // if pi == 0 or Pi == 1
-			     // mysets[s].info += 0.0;	
-			     mysets[s].info_bit[nbit]=1; // because the entropy is 0
+			     ms->info_bit[nbit]=1; // because the entropy is 0
 			}
-		  //printf("%d  %d  %f \n", s, nbit, mysets[s].info_bit[nbit]);
 		}
-	
-	
 
 		// 2nd pass to calculate the correlation bits
-		double corr_temp, corr_max;
 		for (nbit=0;nbit<42; nbit++){
 			corr_max =0;
 			for (i=nbit-1;i>=0;i--){
-				if (nbit==i){
-					corr_temp =0;
-				} else {
-					corr_temp = corr(mysets[s],nbit,i) * mysets[s].corr_info[i] ; 
-				}	
+				corr_temp = corr(ms,nbit,i) * ms->corr_info[i] ;
 				// take the maximum value
 				if (corr_temp > corr_max)  corr_max = corr_temp;
 			}
-		
-			if (corr_max >  mysets[s].info_bit[nbit]){
-				 mysets[s].corr_info[nbit] = corr_max ;
+
+			if (corr_max >  ms->info_bit[nbit]){
+				 ms->corr_info[nbit] = corr_max ;
 			} else{
-				 mysets[s].corr_info[nbit] =  mysets[s].info_bit[nbit] ;
+				 ms->corr_info[nbit] =  ms->info_bit[nbit] ;
 			}
 			// calculate the total correlation information leakage in the set
-			mysets[s].c_total_info+=mysets[s].corr_info[nbit];
+			ms->c_total_info+=ms->corr_info[nbit];
 		}
-
 	}
+}
+
+
+void compute_entropies(struct sets *mysets, int set_lines){
+	set_part parts[SET_THREADS];
+	int set_bits = log2(set_lines);
+
+	set_parts_run(parts, entropy_part, mysets, set_lines, set_bits, 0);
 	return;
 }
 
 
+// print_part formats the lines of the sets of part for both Results files
+static void print_part(set_part *part){
+	struct sets *ms;
+	int s, nbit;
+	double avg_heavy_leak, avg_cor_heavy_leak;
+
+        for(s=part->first; s<part->last ;s++){
+		ms = &part->mysets[s];
+		avg_heavy_leak =  ms->elements * (42 - ms->info)/part->elements_sum;
+                avg_cor_heavy_leak =  ms->elements *  ms->c_total_info /part->elements_sum;
+		ob_printf(&part->avg,"%ld,%ld,%f,%f,%f,%f,%f,%f,%f\n",(long) s, ms->elements ,ms->info, 42 - ms->info, part->set_bits - ms->set_index_info, 42 - part->set_bits - ms->tag_info ,avg_heavy_leak, ms->c_total_info, avg_cor_heavy_leak);
+	}
+	for (s=part->first; s<part->last; s++){
+		ms = &part->mysets[s];
+        	for (nbit=0;nbit<42; nbit++){
+			if (ms->elements ==0){
+                                ms->p1[nbit] =0;
+                        } else {
+                                ms->p1[nbit]=  (double) ms->num_1[nbit]/(double) ms->elements;
+                        }
+			ob_printf(&part->by_set,"%d,%d,%f,%f\n", s, nbit, ms->p1[nbit],ms->corr_info[nbit]);
+        	}
+	}
+}
+
+
 void print_results (FILE *fp,FILE * fp2,struct sets *mysets, int scheme, int set_lines){
 	//printf("------------------------------\n");
 	fprintf(fp,"Number of addresses read : %lld\n", a_number);
@@ -747,13 +711,14 @@ void print_results (FILE *fp,FILE * fp2,struct sets *mysets, int scheme, int set
 	}
 
 //	printf("------------------------------\n");
-	int s=0, nbit=0;
+	set_part parts[SET_THREADS];
+	int nparts, k;
+	int s=0;
 	uint64_t elements_sum=0;
         double  entropy_average=0,  leak_average=0;
-        double  avg_heavy_leak=0, total_avg_heavy_leak=0 ; 
+        double  avg_heavy_leak=0, total_avg_heavy_leak=0 ;
         double leak_average_set_index=0, leak_average_tag = 0;
-        double avg_cor_heavy_leak;
-        double  leak_cor_average;
+        double  leak_cor_average=0;
 	int set_bits = log2(set_lines);
 	int set_lines_used =0;
 
@@ -767,15 +732,15 @@ void print_results (FILE *fp,FILE * fp2,struct sets *mysets, int scheme, int set
                       set_lines_used++ ;
 		 }
 	}
+
+	// the lines of each set are formatted by the threads, the averages are summed here in set order
+	nparts = set_parts_run(parts, print_part, mysets, set_lines, set_bits, elements_sum);
+	for (k=0; k<nparts; k++){
+		fwrite(parts[k].avg.p, 1, parts[k].avg.len, fp);
+	}
 	double set_fraction;
         for(s=0; s<set_lines ;s++){
-		//printf("Set: %d\tAcceses: %ld    \tEntropy: %f    \t Info leakage: %f  \n",s, mysets[s].elements ,mysets[s].info, 42 - mysets[s].info );
-		avg_heavy_leak =  mysets[s].elements * (42 - mysets[s].info)/elements_sum; 
-                avg_cor_heavy_leak =  mysets[s].elements *  mysets[s].c_total_info /elements_sum;
-		//fprintf(fp,"%d,%ld,%f,%f,%f,%f,%f\n",s, mysets[s].elements ,mysets[s].info, 42 - mysets[s].info,avg_heavy_leak, mysets[s].c_total_info,avg_cor_heavy_leak);
-		fprintf(fp,"%ld,%ld,%f,%f,%f,%f,%f,%f,%f\n",s, mysets[s].elements ,mysets[s].info, 42 - mysets[s].info, set_bits - mysets[s].set_index_info, 42 - set_bits - mysets[s].tag_info ,avg_heavy_leak, mysets[s].c_total_info, avg_cor_heavy_leak);
-				
-
+		avg_heavy_leak =  mysets[s].elements * (42 - mysets[s].info)/elements_sum;
                 set_fraction = (double) mysets[s].elements/(double)elements_sum;
 		entropy_average += mysets[s].info*set_fraction;
 		leak_average += (42 - mysets[s].info)*set_fraction;
@@ -787,28 +752,14 @@ void print_results (FILE *fp,FILE * fp2,struct sets *mysets, int scheme, int set
 //	fprintf (fp,"Total Addresses: %lld ,Average Entropy: %f ,Average Info Leakage: %f ,Total Avg Heavy Leak: %f\n",elements_sum,entropy_average/set_lines,leak_average/set_lines, total_avg_heavy_leak);
 //	fprintf (fp,"Total Addresses:,%lld,Average Entropy:,%f,Average Info Leakage,%f, Set Index Leakage, %f, Tag Info Leakage, %f, Total Avg Heavy Leak:,%f\n",elements_sum,entropy_average,leak_average, leak_average_set_index, leak_average_tag, total_avg_heavy_leak);
 	fprintf (fp,"Total Addresses:,%lld,Average Entropy:,%f,Average Info Leakage,%f, Set Index Leakage, %f, Tag Info Leakage, %f, Total Avg Heavy Leak:,%f, Correlation Leak Avg, %f\n",elements_sum,entropy_average,leak_average, leak_average_set_index, leak_average_tag, total_avg_heavy_leak, leak_cor_average);
-	
-	fprintf (fp,"Set lines used:, %d , Utilization:, %f \n", set_lines_used, ((float)set_lines_used/set_lines)  );	
 
-	// print final Ep[i] for s =11
+	fprintf (fp,"Set lines used:, %d , Utilization:, %f \n", set_lines_used, ((float)set_lines_used/set_lines)  );
 
-       	//s =11;
-//	int set_lines_used =0;
         fprintf(fp2,"s,bit_pos,probability\n");
-	for (s=0; s<set_lines; s++){
-//		if (mysets[s].elements !=0) 
-//			set_lines_used++ ;
-        	for (nbit=0;nbit<42; nbit++){
-			if (mysets[s].elements ==0){
-                                mysets[s].p1[nbit] =0;
-                        } else {
-                                mysets[s].p1[nbit]=  (double) mysets[s].num_1[nbit]/(double) mysets[s].elements;
-                        }
-                 	//printf("For s = %d  p1[%d] = %f \n", s, nbit, mysets[s].p1[nbit]);
-		 	//fprintf(fp2,"%d,%d,%f\n", s, nbit, mysets[s].p1[nbit]);
-			fprintf(fp2,"%d,%d,%f,%f\n", s, nbit, mysets[s].p1[nbit],mysets[s].corr_info[nbit]);
-
-        	}
+	for (k=0; k<nparts; k++){
+		fwrite(parts[k].by_set.p, 1, parts[k].by_set.len, fp2);
+		free(parts[k].avg.p);
+		free(parts[k].by_set.p);
 	}
 //	fprintf(fp2,"Set lines used:, %d , %Utilization:, %f \n", s, set_lines_used, (set_lines_used*100)/set_lines );
 	return;
@@ -837,18 +788,25 @@ void	clean_all(cache *cash, int initial_way, int final_way) {
 	int8_t          segment;                //      memory segment code from input
 	int i;
 	int way;
+	uint16_t        *order;                 //      way of each rank of the set, order[0] is the MRU way
 
+	order = malloc(cash->assoc * sizeof(uint16_t));
+	if (order == NULL) {
+		error("Unable to allocate memory for the rank order of a set", -10);
+	}
 	for (i=0 ; i < cash->nmbr_sets ; i++){
 
 		set  = &cash->sets[i];
+		for (way = 0; way < cash->assoc; way++) {
+			order[set->rank[way]] = way;
+		}
 
-		// start with the first cache line of the set 
-	
-		victim = set->lru;
+		// start with the LRU cache line of the set and move toward the MRU line
 
 //		while ( victim != NULL){
 //		for (way = 0; way < cash->assoc; way++) {       //      test all lines in the set
 		for (way = initial_way; way < final_way; way++) {       //      test all lines in the set
+			victim = &set->ways[order[cash->assoc - 1 - (way - initial_way)]];
 			if (victim->valid != 0  &&  victim->dirty != 0) {                       //      write-back is needed?
         	                victim->oper = MRWRITE;
 				main_mem = (cash->lower == NULL);     				// Not write back if we are in the last memory 
@@ -858,11 +816,14 @@ void	clean_all(cache *cash, int initial_way, int final_way) {
 				}
                 	        set->wrback[segment]++;                                         //      increment write back counter
 	        	}
-            	        victim->valid =0;
+			if (victim->valid != 0) {		//	tag of a line not valid is already CL_NOTAG
+				victim->valid = 0;
+				CL_SET_TAG(victim);
+			}
 			victim->dirty = 0;
-			victim = victim->mru;
 		}
 	}
+	free(order);
 	// reset the DES password
 	// generate a new dea_key
         generate_rand(&des_key);
@@ -878,12 +839,15 @@ void		cl_init(cacheline *cl) {
 	//	The cache line is already part of a set, just need to clear data
 	//	and flags from any prior use
 	cl->adrs = 0;
-	for (i = 0; i < cl->owner->config->lin_siz; i++) {
-		cl->data[i] = 0;
-		cl->orig[i] = 0;
-		cl->stat[i] = 0;
+	if (!tags_only) {
+		for (i = 0; i < cl->owner->config->lin_siz; i++) {
+			cl->data[i] = 0;
+			cl->orig[i] = 0;
+			cl->stat[i] = 0;
+		}
 	}
 	cl->valid = 0;
+	CL_SET_TAG(cl);
 	cl->referncd = 0;
 	cl->dirty = 0;
 	cl->shared = 0;
@@ -910,50 +874,107 @@ int8_t		is_dead(int64_t adrs, int8_t segment) {
 
 
 
+//	The replacement order of a set is its rank array, see cacheset in moola.h.  The rank
+//	arrays are 16 byte aligned and have a multiple of 8 entries, so with SSE2 each group of
+//	8 ways is one compare and update.  SSE2 only has signed 16 bit compares, so the ranks are
+//	compared after flipping their top bit (RANK_BIAS), which orders them as unsigned values.
+#ifdef __SSE2__
+#define RANK_BIAS	_mm_set1_epi16((short) 0x8000)
+#endif
+
 //			move2_lru		move the input cacheline to the least recently used position
+//							every line less recent than it moves one position toward the MRU
 void		move2_lru(cacheset *set, cacheline *cl) {
+	uint16_t	*rank;			//	rank array of the set
+	int32_t		last;			//	rank of the LRU line
+	int32_t		r;				//	current rank of the input line
+	int32_t		w;				//	way index
 	
-	if (set->lru == cl) {
+	rank = set->rank;
+	last = set->owner->assoc - 1;
+	r = rank[cl - set->ways];
+	if (r == last) {
 		return;					//	already LRU, so just return
 	}
+#ifdef __SSE2__
+	__m128i		bv;				//	ranks of 8 ways with the top bit flipped
+	__m128i		rv;				//	r in each rank, top bit flipped
+	__m128i		lv;				//	last + 1 in each rank, top bit flipped
+	__m128i		v;				//	ranks of 8 ways
 	
-	//	The cache lines in a set form a dual linked ring.
-	//  The first step is to remove the input cache line from the ring
-	cl->lru->mru = cl->mru;
-	cl->mru->lru = cl->lru;
-	//  Now insert it after the current LRU
-	if (set->mru == cl) {		//	is cl the current MRU line
-		set->mru = cl->lru;		//	get new MRU line
-	}
-	cl->mru = set->lru;			//  line's more recent link goes to current LRU
-	cl->lru = set->mru;			//	line's less recent link goes to current MRU
-	set->lru->lru = cl;			//  place line after current LRU
-	set->mru->mru = cl;			//  place line "before" current MRU
-	set->lru = cl;				//	make line the current LRU
+	rv = _mm_xor_si128(_mm_set1_epi16((short) r), RANK_BIAS);
+	lv = _mm_xor_si128(_mm_set1_epi16((short) (last + 1)), RANK_BIAS);
+	for (w = 0; w < set->owner->rank_ways; w += 8) {
+		v = _mm_load_si128((__m128i *) &rank[w]);
+		bv = _mm_xor_si128(v, RANK_BIAS);
+		//	r < v <= last gives -1, adding it decrements the rank
+		v = _mm_add_epi16(v, _mm_and_si128(_mm_cmpgt_epi16(bv, rv), _mm_cmpgt_epi16(lv, bv)));
+		_mm_store_si128((__m128i *) &rank[w], v);
+	}
+#else
+	for (w = 0; w <= last; w++) {
+		rank[w] -= (rank[w] > r);
+	}
+#endif
+	rank[cl - set->ways] = last;
 }
 
 
 
 //			move2_mru		move the input cacheline to the most recently used position
+//							every line more recent than it moves one position toward the LRU
 void		move2_mru(cacheset *set, cacheline *cl) {
+	uint16_t	*rank;			//	rank array of the set
+	int32_t		r;				//	current rank of the input line
+	int32_t		w;				//	way index
 	
-	if (set->mru == cl) {
+	rank = set->rank;
+	r = rank[cl - set->ways];
+	if (r == 0) {
 		return;					//	already MRU, so just return
 	}
+#ifdef __SSE2__
+	__m128i		rv;				//	r in each rank, top bit flipped
+	__m128i		v;				//	ranks of 8 ways
 	
-	//	The cache lines in a set form a dual linked ring.
-	//  The first step is to remove the input cache line from the ring
-	cl->lru->mru = cl->mru;
-	cl->mru->lru = cl->lru;
-	//  Now insert it before the current MRU
-	if (set->lru == cl) {		//	is cl the current LRU line
-		set->lru = cl->mru;		//	get new LRU line
-	}
-	cl->mru = set->lru;			//  line's more recent link goes to current LRU
-	cl->lru = set->mru;			//	line's less recent link goes to current MRU
-	set->lru->lru = cl;			//  place line "after" current LRU
-	set->mru->mru = cl;			//  place line before current MRU
-	set->mru = cl;				//	make line the current MRU
+	rv = _mm_xor_si128(_mm_set1_epi16((short) r), RANK_BIAS);
+	for (w = 0; w < set->owner->rank_ways; w += 8) {
+		v = _mm_load_si128((__m128i *) &rank[w]);
+		//	v < r gives -1, subtracting it increments the rank (RANK_PAD is never below r)
+		v = _mm_sub_epi16(v, _mm_cmplt_epi16(_mm_xor_si128(v, RANK_BIAS), rv));
+		_mm_store_si128((__m128i *) &rank[w], v);
+	}
+#else
+	for (w = 0; w < set->owner->assoc; w++) {
+		rank[w] += (rank[w] < r);
+	}
+#endif
+	rank[cl - set->ways] = 0;
+}
+
+
+
+//			rank_find		return the cache line of the set with replacement rank 'rank',
+//							0 is the MRU line and assoc - 1 is the LRU line
+cacheline  *rank_find(cacheset *set, int32_t rank) {
+	int32_t		w;				//	way index
+	
+#ifdef __SSE2__
+	__m128i		rv;				//	rank in each entry
+	int32_t		mask;			//	2 bits for each way of the group of 8 with the rank
+	
+	rv = _mm_set1_epi16((short) rank);
+	for (w = 0; ; w += 8) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((__m128i *) &set->rank[w]), rv));
+		if (mask != 0) {
+			return &set->ways[w + __builtin_ctz(mask) / 2];
+		}
+	}
+#else
+	for (w = 0; set->rank[w] != rank; w++) {
+	}
+	return &set->ways[w];
+#endif
 }
 
 
@@ -978,11 +999,36 @@ void	print_cntrs(char *msg, cache *cash, int sgmnt) {
 
 
 
-//			reference		performs a cache reference from the processor or from a higher
+//	update_tag	the -tags_only form of update_cl, only updates the status of the dst line with the
+//				oper and valid bits of the input.  There are no bytes to copy or to classify.
+static inline
+void		update_tag(int8_t oper, int16_t valid, cacheline *dst) {
+	
+	dst->valid |= valid;
+	CL_SET_TAG(dst);
+	if (oper == MRWRITE) {
+		dst->dirty |= 1;
+	} else {
+		dst->referncd |= 1;
+	}
+}
+
+
+
+//			ref_body		performs a cache reference from the processor or from a higher
 //							level cache.  See discussion below for 3 types of invoking reference
 //							The time of the reference completion is returned.
-
-int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
+//							The settings of the cache that are fixed by init_cache are passed as
+//							constants by the REF_VARIANT functions below so that each variant
+//							is compiled without the branches on them:
+//	arch_b:					cash->config->arch is 'b'
+//	main_mem:				cash is the main memory pseudo cache (cash->lower is NULL)
+//	test_cache:				cash is the data cache of the -cache_test level
+//	no_data:				-tags_only, the lines have no data, orig, or stat bytes
+
+static inline __attribute__((always_inline))
+int64_t		ref_body(cache *cash, memref *mr, cacheline *cl,
+					 const int arch_b, const int main_mem, const int test_cache, const int no_data) {
 	int64_t		adrs_in;		//	input address of mr or cl
 	int64_t		break_adrs;		//	set to value for a break point
 	int64_t		break_lnmbr;	//	set to value for a break point
@@ -991,7 +1037,6 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	int64_t		crnt_time;		//	current time of recent action
 	int64_t		duration;		//	accumulate time duration for this reference
 	cacheline	*hit;			//	indicates cache hit when not NULL, miss when NULL
-	int			main_mem;		//	flag set to 1 when cash is main memory pseudo cache
 	char		*memtrace_str = "RWMIriafsn--";		//  memtrace access type output string
 	int16_t		offset;			//	offset between cl->adrs and hit->adrs
 	int8_t		oper;			//  operation to perform
@@ -1117,16 +1162,9 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	}
 #endif
 	
-	//	first determine if this reference is to main memory pseudo cache as this is
-	//	used in multiple locations within reference()
-	main_mem = (cash->lower == NULL);
-	cacheline *cl2, *cl3;
-	cl2 = mem.sets[0].lru;
-	cl2 = mem.sets[0].mru;
+	//	main memory pseudo cache setup, main_mem is used in multiple locations within reference()
 	if (main_mem) {
 		set = &cash->sets[0];
-		cl2 = set->lru;
-		cl3 = set->mru;
 		hit = NULL;
 		if (memtracefil) {
 			fprintf(memtracefil, "%lld: %c 0x%llx\n", cl->time, memtrace_str[cl->oper], cl->adrs);
@@ -1153,7 +1191,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 		if (tagadrs != tagadrs2) {
 			ref1 = ref_split(cash, mr);					//	split reference into 2: ref1 and updated mr
 			cash->split_blk++;							//	increment split counter
-			mr->time = reference(cash, ref1, NULL);		//	process first reference, update mr start time
+			mr->time = cash->ref_fn(cash, ref1, NULL);	//	process first reference, update mr start time
 			free_memref(ref1);
 			tagadrs = mr->adrs & cash->tagmask;			//	set to second reference tag value
 		}
@@ -1170,7 +1208,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	}
 
 
-	set_nmbr = (((int32_t) adrs_in) & cash->setmask) >> cash->log2blksize;
+	set_nmbr = cash->map.fn(&cash->map, (uint64_t) (adrs_in >> cash->map.adrs_shift));
 
 
         // only change the set in the share cache
@@ -1240,13 +1278,20 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	        if (a > max_addr) { max_addr = a; }
 
 
-	if ( (cash->ins_or_data == 1) && (cash->level==cache_test) &&  (cache_test >0)  ){    // Only save data and print of level of the select cache
+	if (test_cache) {    // Only save data and print of level of the select cache
 		a_number++;
 		set__lines= cash->nmbr_sets;
-		set_nmbr   = compute_set(a,scheme, cash->nmbr_sets);	
 
 		//calculate Ps
-		estimatePs(&mysets[set_nmbr],a);
+		if (csv_fil_name2) {
+			if (cash->nmbr_sets > nmbr_mysets) {
+				grow_sets(cash->nmbr_sets);
+			}
+			estimatePs(&mysets[set_nmbr],a);
+			if (nmbr_schemes > 1) {
+				schemes_add(cash, a);
+			}
+		}
 
 		set = &cash->sets[set_nmbr];
                 set->access[segment]++;         //      increment access counter
@@ -1262,7 +1307,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
             clean_all (cash,0, cash->assoc);
 			counter_reflash =0;
 			counter ++;
-            if ( scheme == 7){  // only in case of use DES scheme
+            if ( cash->map.scheme == 7  ||  nmbr_schemes > 1){  // only in case of use DES scheme (-schemes runs may use it)
 				// generate a new dea_key
 				generate_rand(&des_key);
 			}
@@ -1370,6 +1415,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 			printf("WARNING: cacheline invalidate for %lld resulted in cache miss\n", adrs_in);
 		} else {
 			hit->valid = 0;
+			CL_SET_TAG(hit);
 			move2_lru(set, hit);
 			set->nvalid[segment]++;						//	increment invalidate counter
 		}
@@ -1385,7 +1431,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	
 	//	set stall value to any delay due to busy cache and update appropriate time field(s)
 	if (cash->acss_time[cblock] > ref_time) {		//	stall is needed when true
-		if (cash->config->arch == 'b'  ||  !hit  || (hit  &&  tagadrs == cash->miss_tag[cblock])) {
+		if (arch_b  ||  !hit  || (hit  &&  tagadrs == cash->miss_tag[cblock])) {
 			stall = cash->miss_time[cblock] - ref_time;		//	stall until prior miss resolved
 		} else {
 			stall = cash->acss_time[cblock] - ref_time;		//	stall until prior access completed
@@ -1427,12 +1473,12 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	if (hit == NULL) {
 		cash->miss[oper]++;											//	update cache miss counter
 		//	no match was found, need to	determine if evict a line, if so, get the victim
-		victim = set->lru;											//	get LRU cache line in the set
+		victim = rank_find(set, cash->assoc - 1);					//	get LRU cache line in the set
 		if (victim->valid != 0  &&  victim->dirty != 0) {			//	write-back is needed?
 			victim->oper = MRWRITE;
 			victim->time = crnt_time;
 			if (!main_mem) {
-				crnt_time = reference(cash->lower, NULL, victim);	//	write back data and mark time
+				crnt_time = cash->lower->ref_fn(cash->lower, NULL, victim);	//	write back data and mark time
 				cash->last_busy = crnt_time;						//  mark cache as busy during write back
 			}
 			set->wrback[segment]++;									//	increment write back counter
@@ -1444,6 +1490,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 		victim->time = crnt_time;
 		move2_mru(set, victim);										//	make it most recently used
 		victim->adrs = adrs_in & tagadrs;							//	setup address, operation, segment
+		CL_SET_TAG(victim);
 		victim->oper = oper;
 		victim->segment = segment;
 
@@ -1454,8 +1501,11 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 				if (mr != NULL) {
 					mr->time = crnt_time;
 				}
-				crnt_time = reference(cash->lower, mr, victim);		//	fetch line from lower level
+				crnt_time = cash->lower->ref_fn(cash->lower, mr, victim);	//	fetch line from lower level
 				cash->miss_tag[cblock] = tagadrs;					//	save tag of line being fetched
+			} else if (no_data) {
+				victim->valid = 1;									//	no data to init with -tags_only
+				CL_SET_TAG(victim);
 			} else {
 				offset = (int16_t) (mr->adrs - victim->adrs);		//	use mr->data to init victim
 				if (write_op) {
@@ -1472,6 +1522,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 					victim->stat[offset] |= CBLEMNT;				//	mark as element start byte
 				}
 				victim->valid = 1;									//	TBD update for subblock tracking
+				CL_SET_TAG(victim);
 			}
 		}
 		hit = victim;												//	can now process as a hit
@@ -1480,7 +1531,17 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 	}
 
 	//  Do what you gotta do with the data now
-	if (ref_case == 1) {				//	use mr->data to update hit->data
+	if (no_data) {
+		//	-tags_only has no line data, only the status of the lines is updated
+		if (ref_case == 1) {
+			update_tag(oper, 1, hit);
+		} else if (ref_case == 3) {
+			update_tag(oper, cl->valid, hit);
+		} else {
+			cl->valid = hit->valid;
+			CL_SET_TAG(cl);
+		}
+	} else if (ref_case == 1) {			//	use mr->data to update hit->data
 		update_cl(mr, NULL, hit);
 	} else if (ref_case == 3) {
 		update_cl(NULL, cl, hit);		//	use cl->data to update hit->data (write-back)
@@ -1503,6 +1564,7 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 		}
 		//	TBD need to update subblock status bits
 		cl->valid = hit->valid;
+		CL_SET_TAG(cl);
 		
 	}
 	
@@ -1522,6 +1584,112 @@ int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
 
 
 
+//	REF_VARIANT defines a reference function for one combination of the ref_body settings;
+//	ref_variants is indexed by arch_b * 8 + main_mem * 4 + test_cache * 2 + no_data.
+#define REF_VARIANT(a, m, t, d)																\
+static int64_t	ref_##a##m##t##d(cache *cash, memref *mr, cacheline *cl) {					\
+	return ref_body(cash, mr, cl, a, m, t, d);												\
+}
+#define REF_VARIANTS(a, m)	REF_VARIANT(a, m, 0, 0) REF_VARIANT(a, m, 0, 1)					\
+							REF_VARIANT(a, m, 1, 0) REF_VARIANT(a, m, 1, 1)
+REF_VARIANTS(0, 0)
+REF_VARIANTS(0, 1)
+REF_VARIANTS(1, 0)
+REF_VARIANTS(1, 1)
+
+static int64_t	(*const ref_variants[16])(cache *, memref *, cacheline *) = {
+	ref_0000, ref_0001, ref_0010, ref_0011, ref_0100, ref_0101, ref_0110, ref_0111,
+	ref_1000, ref_1001, ref_1010, ref_1011, ref_1100, ref_1101, ref_1110, ref_1111
+};
+
+
+//	init_reference	binds the reference function variant for the settings of cash.  Called by
+//					init_cache after the configuration options, level, and lower cache are set.
+void		init_reference(cache *cash) {
+	int32_t		ndx;			//	index of the variant in ref_variants
+	
+	ndx  = (cash->config->arch == 'b') * 8;
+	ndx += (cash->lower == NULL) * 4;
+	ndx += (cash->ins_or_data == 1  &&  cash->level == cache_test  &&  cache_test > 0) * 2;
+	ndx += (tags_only != 0);
+	cash->ref_fn = ref_variants[ndx];
+}
+
+
+//			reference		performs a cache reference from the processor or from a higher
+//							level cache with the variant bound to the cache by init_reference.
+//							The time of the reference completion is returned.
+
+int64_t		reference(cache *cash, memref *mr, cacheline *cl) {
+	
+	return cash->ref_fn(cash, mr, cl);
+}
+
+
+
+//			reference_l1	performs a processor reference (case 1 of reference) to an L1 cache.
+//							A reference within one cache line that hits is completed here with
+//							the same counter and time updates as reference(); a miss, a split
+//							reference, or the -cache_test cache is passed on to reference().
+
+int64_t		reference_l1(cache *cash, memref *mr) {
+	uint64_t	a;				//	line address for the memory footprint
+	int64_t		crnt_time;		//	completion time of the reference
+	cacheline	*hit;			//	matching line of the set
+	int64_t		ref_time;		//	local time of start of the cache reference
+	cacheset	*set;			//	pointer to matching set for input address
+	int32_t		set_nmbr;		//	set number of mr input address
+	int64_t		stall;			//	duration of time stalled waiting for cache available
+	int64_t		tagadrs;		//	cache line address of mr input address
+	
+	tagadrs = mr->adrs & cash->tagmask;
+	if (tagadrs != ((mr->adrs + mr->size - 1) & cash->tagmask)
+		||  (cash->ins_or_data == 1  &&  cash->level == cache_test  &&  cache_test > 0)) {
+		return cash->ref_fn(cash, mr, NULL);
+	}
+	set_nmbr = cash->map.fn(&cash->map, (uint64_t) (mr->adrs >> cash->map.adrs_shift));
+	hit = search(cash, tagadrs, set_nmbr);
+	if (hit == NULL) {
+		return cash->ref_fn(cash, mr, NULL);
+	}
+	
+	a = mr->adrs >> 6;
+	if (a < min_addr) { min_addr = a; }
+	if (a > max_addr) { max_addr = a; }
+	set = &cash->sets[set_nmbr];
+	set->access[mr->segmnt]++;						//	increment access counter
+	
+	//	stall and time updates of reference() for a hit in cache block 0
+	ref_time = mr->time;
+	if (cash->acss_time[0] > ref_time) {
+		if (cash->config->arch == 'b'  ||  tagadrs == cash->miss_tag[0]) {
+			stall = cash->miss_time[0] - ref_time;	//	stall until prior miss resolved
+		} else {
+			stall = cash->acss_time[0] - ref_time;	//	stall until prior access completed
+		}
+		cash->wait_time += stall;
+		ref_time += stall;
+	} else {
+		cash->idle_time += ref_time - cash->last_busy;
+	}
+	crnt_time = ref_time + cash->config->access;
+	cash->acss_time[0] = crnt_time;
+	cash->miss_time[0] = crnt_time;
+	cash->last_busy = crnt_time;
+	mr->time = crnt_time;
+	
+	set->hits[mr->segmnt]++;						//	increment hit counter
+	cash->fetch[mr->oper]++;						//	update cache access counter
+	if (tags_only) {
+		update_tag(mr->oper, 1, hit);
+	} else {
+		update_cl(mr, NULL, hit);
+	}
+	return crnt_time;
+}
+
+
+
 //  ref_split	Takes a memory reference that crosses a cache-line boundary
 //				and splits it into 2 cache-line aligned references.
 //				The reference to the first cache line is returned from the function
@@ -1542,7 +1710,7 @@ memref *ref_split(cache *cash, memref *mr) {
 	size1 = (int32_t) (tagadrs2 - mr->adrs);
 
 	//  Move appropriate info from mr to ref1, adjusting as needed
-	ref1 = get_memref();
+	ref1 = get_memref_raw();		//	every field used by reference() is set below
 	ref1->adrs = mr->adrs;			//	use initial address for ref1
 	ref1->time = mr->time;			//	copy the time field
 	ref1->linenmbr = mr->linenmbr;	//	copy the source file line number initiating this reference
@@ -1595,15 +1763,77 @@ memref *ref_split(cache *cash, memref *mr) {
 }
 
 
+//	tag_match_*	compare 'tag' with the first 'ways' entries of the tag array of a set and return
+//				a mask with bit w set when tags[w] matches.  'ways' is a multiple of 4, at most 64.
+static uint64_t	tag_match_scalar(int64_t *tags, int64_t tag, int32_t ways) {
+	uint64_t	match;			//	mask of the matching ways
+	int32_t		w;				//	way index
+	
+	match = 0;
+	for (w = 0; w < ways; w++) {
+		match |= (uint64_t) (tags[w] == tag) << w;
+	}
+	return match;
+}
+
+
+#ifdef SEARCH_X86
+__attribute__((target("avx2")))
+static uint64_t	tag_match_avx2(int64_t *tags, int64_t tag, int32_t ways) {
+	__m256i		key;			//	tag in each of the 4 lanes
+	__m256i		eq;				//	lanes of 4 ways that match
+	uint64_t	match;			//	mask of the matching ways
+	int32_t		w;				//	way index
+	
+	key = _mm256_set1_epi64x(tag);
+	match = 0;
+	for (w = 0; w < ways; w += 4) {
+		eq = _mm256_cmpeq_epi64(_mm256_load_si256((__m256i *) &tags[w]), key);
+		match |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(eq)) << w;
+	}
+	return match;
+}
+#endif
+
+
+static uint64_t	(*tag_match)(int64_t *, int64_t, int32_t) = tag_match_scalar;
+
+
+//	search_init	select the tag compare for this processor.  Called once at startup.
+void		search_init(void) {
+#ifdef SEARCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		tag_match = tag_match_avx2;
+	}
+#endif
+	return;
+}
+
+
 //	search		looks through the ways in the set to see if the input address matches the tag in the set
 //				TBD subblocks not yet implemented (are subblocks even considered here?
+//				The tag array of the set is compared first.  When no way matches it is a miss, when
+//				exactly one way matches and all ways are in use it is that way.  Otherwise (duplicate
+//				tags, -dynamic_ways limiting the ways, or more than 64 ways) the hit is the matching
+//				line nearest the MRU among the 'associativity' most recently used lines.
 cacheline  *search(cache *cash, int64_t tagadrs, int32_t set_nmbr) {
 	int			way;
 	cacheline	*cl;
 	cacheset	*set;
+	uint64_t	match;			//	mask of the ways whose tag matches
+	int			best;			//	rank of the matching line found so far
 	
 	set = &cash->sets[set_nmbr];				//	set from set_nmbr
-	cl = set->mru;								//	most recently used line in the set
+	if (cash->tag_ways <= 64) {
+		match = tag_match(set->tags, tagadrs, cash->tag_ways);
+		if (match == 0) {
+			return NULL;
+		}
+		if ((match & (match - 1)) == 0  &&  cash->actual_way == cash->assoc) {
+			return &set->ways[__builtin_ctzll(match)];
+		}
+	}
 	
 	int associativity;
 	int dynamic_assoc =0 ;
@@ -1624,41 +1854,188 @@ cacheline  *search(cache *cash, int64_t tagadrs, int32_t set_nmbr) {
 	
 //	for (way = 0; way < cash->assoc; way++) {	//	test all lines in the set
 //	if ((cash->ins_or_data == 1) && (cash->level  == cache_test)) printf("Assoc: %d and %d\n", associativity, cash->actual_way);
-	for (way = 0; way < associativity; way++) {   //	test all lines in the set
-		if (cl->valid  &&  cl->adrs == tagadrs) {
-			return cl;
+	cl = NULL;
+	best = associativity;						//	only lines of rank below associativity can hit
+	for (way = 0; way < cash->assoc; way++) {   //	test all lines in the set
+		if (set->tags[way] == tagadrs  &&  set->rank[way] < best) {
+			cl = &set->ways[way];
+			best = set->rank[way];
 		}
-		cl = cl->lru;							//	go to next less recently used line
 	}
-	return NULL;
+	return cl;
 }
 
 
 
+//	The bytes of an update_cl transfer are processed in groups of 64.  cl_group() updates the
+//	destination data, orig, and stat bytes of a group and returns the status of the group as bit
+//	masks, bit i for byte i of the group.  The counters of update_cl are derived from the masks.
+typedef struct cl_masks_rec {
+	uint64_t	src_valid;		//	source byte is valid
+	uint64_t	dst_valid;		//	destination byte was valid
+	uint64_t	same;			//	source data byte equals the prior destination data byte
+	uint64_t	last_wr;		//	destination byte was last accessed by a write
+	uint64_t	lmnt;			//	source byte is an element start
+} cl_masks;
+
+
+//	cl_group	updates n (1-64) destination bytes from the source stat, data, and orig bytes and
+//				fills in m.  Partial groups of 16 bytes go through local buffers so that no byte
+//				outside of the transfer is read or written.
+static void	cl_group(uint8_t *stat, uint8_t *data, uint8_t *orig, cacheline *dst, int32_t dst_ndx,
+					 int32_t n, int8_t read, cl_masks *m) {
+	uint8_t		bfr[6][16];		//	source and destination bytes of a partial group of 16
+	uint8_t		*dd;			//	destination data of a group of 16
+	uint8_t		*dor;			//	destination orig of a group of 16
+	uint8_t		*ds;			//	destination stat of a group of 16
+	int32_t		g;				//	index of the group of 16
+	int32_t		k;				//	number of bytes in the group of 16
+	uint8_t		*sd;			//	source data of a group of 16
+	uint8_t		*so;			//	source orig of a group of 16
+	uint8_t		*ss;			//	source stat of a group of 16
+	
+	m->src_valid = m->dst_valid = m->same = m->last_wr = m->lmnt = 0;
+	for (g = 0; g < n; g += 16) {
+		k = (n - g < 16) ? n - g : 16;
+		ss = stat + g;
+		sd = data + g;
+		so = orig + g;
+		ds = dst->stat + dst_ndx + g;
+		dd = dst->data + dst_ndx + g;
+		dor = dst->orig + dst_ndx + g;
+		if (k < 16) {
+			memset(bfr, 0, sizeof(bfr));
+			memcpy(bfr[0], ss, k);
+			memcpy(bfr[1], sd, k);
+			memcpy(bfr[2], so, k);
+			memcpy(bfr[3], ds, k);
+			memcpy(bfr[4], dd, k);
+			memcpy(bfr[5], dor, k);
+			ss = bfr[0];
+			sd = bfr[1];
+			so = bfr[2];
+			ds = bfr[3];
+			dd = bfr[4];
+			dor = bfr[5];
+		}
+#ifdef __SSE2__
+		__m128i		vss, vsd, vds, vdd;		//	source stat/data, destination stat/data
+		__m128i		sv, dv, st, fill;		//	byte masks: src valid, dst valid, element start, orig fill
+		__m128i		ns;						//	new destination stat
+		
+		vss = _mm_loadu_si128((__m128i *) ss);
+		vsd = _mm_loadu_si128((__m128i *) sd);
+		vds = _mm_loadu_si128((__m128i *) ds);
+		vdd = _mm_loadu_si128((__m128i *) dd);
+		sv = _mm_cmpeq_epi8(_mm_and_si128(vss, _mm_set1_epi8(CBVALID)), _mm_set1_epi8(CBVALID));
+		dv = _mm_cmpeq_epi8(_mm_and_si128(vds, _mm_set1_epi8(CBVALID)), _mm_set1_epi8(CBVALID));
+		st = _mm_cmpeq_epi8(_mm_and_si128(vss, _mm_set1_epi8(CBLEMNT)), _mm_set1_epi8(CBLEMNT));
+		m->src_valid |= (uint64_t) _mm_movemask_epi8(sv) << g;
+		m->dst_valid |= (uint64_t) _mm_movemask_epi8(dv) << g;
+		m->same |= (uint64_t) _mm_movemask_epi8(_mm_cmpeq_epi8(vsd, vdd)) << g;
+		m->last_wr |= (uint64_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(vds, _mm_set1_epi8(CBLSTWR)),
+																   _mm_set1_epi8(CBLSTWR))) << g;
+		m->lmnt |= (uint64_t) _mm_movemask_epi8(st) << g;
+		
+		//	element bits kept for an element start and cleared otherwise, last access bits from the
+		//	operation, valid bit if filled
+		fill = _mm_andnot_si128(dv, sv);
+		ns = _mm_and_si128(vds, _mm_or_si128(_mm_set1_epi8(CBLMNTMSK & CBLSTMSK),
+											 _mm_and_si128(st, _mm_set1_epi8(CBLSTMSK & ~CBLMNTMSK))));
+		ns = _mm_or_si128(ns, _mm_and_si128(st, _mm_set1_epi8(CBLEMNT)));
+		ns = _mm_or_si128(ns, _mm_set1_epi8(read ? CBLSTRD : CBLSTWR));
+		ns = _mm_or_si128(ns, _mm_and_si128(fill, _mm_set1_epi8(CBVALID)));
+		_mm_storeu_si128((__m128i *) ds, ns);
+		_mm_storeu_si128((__m128i *) dd, vsd);
+		_mm_storeu_si128((__m128i *) dor, _mm_or_si128(_mm_and_si128(fill, _mm_loadu_si128((__m128i *) so)),
+												   _mm_andnot_si128(fill, _mm_loadu_si128((__m128i *) dor))));
+#else
+		int32_t		i;				//	byte index in the group of 16
+		int8_t		fill;			//	set when the orig byte is filled from the source
+		
+		for (i = 0; i < 16; i++) {
+			m->src_valid |= (uint64_t) (ss[i] & CBVALID) << (g + i);
+			m->dst_valid |= (uint64_t) (ds[i] & CBVALID) << (g + i);
+			m->same |= (uint64_t) (sd[i] == dd[i]) << (g + i);
+			m->last_wr |= (uint64_t) ((ds[i] & CBLSTWR) != 0) << (g + i);
+			m->lmnt |= (uint64_t) ((ss[i] & CBLEMNT) != 0) << (g + i);
+			fill = (ss[i] & CBVALID)  &&  !(ds[i] & CBVALID);
+			if (ss[i] & CBLEMNT) {
+				ds[i] = (ds[i] & CBLSTMSK) | CBLEMNT;
+			} else {
+				ds[i] = ds[i] & CBLMNTMSK & CBLSTMSK;
+			}
+			ds[i] |= (read ? CBLSTRD : CBLSTWR) | fill;
+			dd[i] = sd[i];
+			if (fill) {
+				dor[i] = so[i];
+			}
+		}
+#endif
+		if (k < 16) {
+			memcpy(dst->stat + dst_ndx + g, ds, k);
+			memcpy(dst->data + dst_ndx + g, dd, k);
+			memcpy(dst->orig + dst_ndx + g, dor, k);
+		}
+	}
+	if (n < 64) {
+		m->src_valid &= (1ULL << n) - 1;
+		m->dst_valid &= (1ULL << n) - 1;
+		m->same &= (1ULL << n) - 1;
+		m->last_wr &= (1ULL << n) - 1;
+		m->lmnt &= (1ULL << n) - 1;
+	}
+}
+
+
+//	seg_hits	the bytes of a group are divided into segments (elements or sub-blocks) that end at
+//				the bits of 'ends'.  Returns the end bits of the segments that have a bit of 'mask'.
+//				Adding the mask to the ones of the bytes that are not ends carries each segment's
+//				first mask bit up to its end.  A segment that continues into the next group passes
+//				its carry there through *carry.
+static inline uint64_t	seg_hits(uint64_t mask, uint64_t ends, uint64_t *carry) {
+	uint64_t	run;			//	ones for the bytes that are not segment ends
+	uint64_t	sum;			//	mask bits plus run
+	uint64_t	sum2;			//	sum plus carry in
+	
+	run = ~ends;
+	sum = (mask & run) + run;
+	sum2 = sum + *carry;
+	*carry = (sum < run)  |  (sum2 < sum);
+	return (sum2 & ends)  |  (mask & ends);
+}
+
+
 //	update_cl	updates a cache line from either the mr input or the cl input
 //				includes updating the dst->data, ->orig, and ->stat arrays.  Also
 //				includes updating the cache access type counters.
 //				Exactly 1 of mr/cl should be valid
+//				Each byte is read, untouched, dead, dusty, useless, or live.  An element takes the first
+//				of read, dead, live, dusty, useless, untouched that it has a byte of.  A sub-block or the
+//				block is read, mixed if it has a dead, dusty, or untouched byte, else live, useless, or
+//				untouched.  The classes are computed as bit masks by cl_group and counted with popcounts.
 void		update_cl(memref *mr, cacheline *cl, cacheline *dst) {
 	
-	int16_t		blk_dead;		//  count dead writes within the block
-	int16_t		blk_dusty;		//  count dusty writes within the block
-	int16_t		blk_live;		//  count live writes within the block
-	int16_t		blk_read;		//  count reads within the block
-	int16_t		blk_untouch;	//  count untouched bytes within the block
-	int16_t		blk_usls;		//  count useless writes within the block
+	uint64_t	blk_any[3];		//	block has a wasted (dead/dusty/untouched), live, useless byte
+	int64_t		*cntr[4];		//	counters of the segment for byte, element, sub-block, block
 	cache		*cash;			//	pointer to cache containing destination line
 	uint8_t		*data;			//	pointer to source current data
-	uint8_t		dst_data;		//  destination data byte
-	int16_t		dst_ndx;		//	index of byte into the destination data/orig/stat arrays
-	int8_t		dst_valid;		//	indicate validity of destination byte
-	int16_t		lmt_dead;		//  count dead writes within an element
-	int16_t		lmt_dusty;		//  count dusty writes within an element
-	int16_t		lmt_flag;		//	increment when element start found (2nd mr of split is not element)
-	int16_t		lmt_live;		//  count live writes within an element
-	int16_t		lmt_read;		//  count reads within an element
-	int16_t		lmt_untouch;	//  count untouched bytes within an element
-	int16_t		lmt_usls;		//  count useless writes within an element
+	uint64_t	dead;			//	dead byte mask of the group
+	uint64_t	dusty;			//	dusty byte mask of the group
+	int32_t		grp;			//	index of first source byte of the group of 64
+	uint64_t	h_dead;			//	end bits of segments with a dead byte
+	uint64_t	h_dusty;		//	end bits of segments with a dusty byte
+	uint64_t	h_live;			//	end bits of segments with a live byte
+	uint64_t	h_untouch;		//	end bits of segments with an untouched byte
+	uint64_t	h_usls;			//	end bits of segments with a useless byte
+	int32_t		i;				//	byte index for dead byte checks and sub-block ends
+	uint64_t	lmt_carry[5];	//	element carries of dead, live, dusty, useless, untouched masks
+	uint64_t	lmt_ends;		//	bytes of the group that end an element
+	uint64_t	live;			//	live byte mask of the group
+	int8_t		lmt_flag;		//	set once an element start was found (2nd mr of split is not element)
+	uint64_t	lmt_on;			//	bytes of the group in an element
+	cl_masks	m;				//	status masks of the group
+	int32_t		n;				//	number of bytes in the group
 	int16_t		offset;			//	difference between source->adrs and dst->adrs
 	int8_t		oper;			//  operation of input
 	uint8_t		*orig;			//	pointer to source orginal data
@@ -1666,17 +2043,12 @@ void		update_cl(memref *mr, cacheline *cl, cacheline *dst) {
 	int16_t		segment;		//	segment of the memory transaction
 	int32_t		size;			//	size of input transaction
 	int64_t		src_adrs;		//	starting address of input
-	uint8_t		src_data;		//  current cache line data byte
-	int16_t		src_ndx;		//	index of byte into the source data array
-	int8_t		src_valid;		//	indicate validity of source byte
 	uint8_t		*stat;			//	pointer to array of status bytes for input
-	int16_t		sub_dead;		//  count dead writes within current subblock
-	int16_t		sub_dusty;		//  count dusty writes within current subblock
-	int16_t		sub_live;		//  count live writes within current subblock
-	int16_t		sub_read;		//  count reads within current subblock
+	uint64_t	sub_carry[3];	//	sub-block carries of wasted, live, useless masks
+	uint64_t	sub_ends;		//	bytes of the group that end a sub-block
 	int16_t		sub_size;		//	bytes per subblock
-	int16_t		sub_untouch;	//  count untouched bytes within current subblock
-	int16_t		sub_usls;		//  count useless writes within current subblock
+	uint64_t	untouch;		//	untouched byte mask of the group
+	uint64_t	usls;			//	useless byte mask of the group
 	int16_t		valid;			//	set if cache line is valid
 	
 	static
@@ -1740,160 +2112,119 @@ void		update_cl(memref *mr, cacheline *cl, cacheline *dst) {
 	}
 	read = !(oper == MRWRITE  ||  oper == MRMODFY);
 	
-
+	cntr[BYT_RES] = cash->cntrs[segment][BYT_RES];
+	cntr[LMT_RES] = cash->cntrs[segment][LMT_RES];
+	cntr[SUB_RES] = cash->cntrs[segment][SUB_RES];
+	cntr[BLK_RES] = cash->cntrs[segment][BLK_RES];
+	
 	//	initialize all flags
-	blk_dead = 0;
-	blk_dusty = 0;
-	blk_live = 0;
-	blk_untouch = 0;
-	blk_usls = 0;
+	blk_any[0] = blk_any[1] = blk_any[2] = 0;
 	lmt_flag = 0;
-	sub_dead = 0;
-	sub_dusty = 0;
-	sub_live = 0;
-	sub_read = 0;
-	sub_untouch = 0;
-	sub_usls = 0;
+	for (i = 0; i < 5; i++) {
+		lmt_carry[i] = 0;
+	}
+	sub_carry[0] = sub_carry[1] = sub_carry[2] = 0;
 	
-	//	Loop through all of the source bytes
-	for (src_ndx = 0; src_ndx < size; src_ndx++) {
-		dst_ndx = src_ndx + offset;
-		src_data = data[src_ndx];
-		dst_data = dst->data[dst_ndx];
-		src_valid = (stat[src_ndx] & CBVALID);
-		dst_valid = (dst->stat[dst_ndx] & CBVALID);
+	//	Loop through the source bytes a group of 64 at a time
+	for (grp = 0; grp < size; grp += 64) {
+		n = (size - grp < 64) ? size - grp : 64;
+		cl_group(stat + grp, data + grp, orig + grp, dst, offset + grp, n, read, &m);
 		
-		//	if source indicates an element start, clear flags and set destination status correctly
-		if (stat[src_ndx] & CBLEMNT) {
-			lmt_dead = 0;
-			lmt_dusty = 0;
-			lmt_flag = 1;
-			lmt_live = 0;
-			lmt_untouch = 0;
-			lmt_usls = 0;
-			dst->stat[dst_ndx] |= CBLEMNT;		//	set element bit
-		} else {
-			dst->stat[dst_ndx] &= CBLMNTMSK;	//	clear element bit
+		//	an element ends before the next element start or at the last byte of the transfer, the
+		//	bytes before the first element start of the transfer are not part of an element
+		lmt_ends = m.lmnt >> 1;
+		if (grp + 64 < size  &&  (stat[grp + 64] & CBLEMNT)) {
+			lmt_ends |= 1ULL << 63;
 		}
+		if (grp + n == size) {
+			lmt_ends |= 1ULL << (n - 1);
+		}
+		lmt_on = ~0ULL;
+		if (lmt_flag == 0) {
+			lmt_on = ~((m.lmnt & -m.lmnt) - 1);		//	from the first element start on
+			lmt_flag = (m.lmnt != 0);
+		}
+		lmt_ends &= lmt_on;
 		
-		//	update the appropriate byte resolution counter for this byte
-		//	and set appropriate block, element, and sub-block flags
-		if (read) {
-			cash->cntrs[segment][BYT_RES][READ_ACS]++;			//	update read byte counter
-			blk_read = 1;
-			lmt_read = 1;
-			sub_read = 1;
-			dst->stat[dst_ndx] = (dst->stat[dst_ndx] & CBLSTMSK)  | CBLSTRD;		//	mark last access RD
-		} else {
-			if (src_valid == 0) {
-				cash->cntrs[segment][BYT_RES][UNTOUCH]++;
-				blk_untouch = 1;
-				lmt_untouch = 1;
-				sub_untouch = 1;
-			} else if (cash->level != 1 &&  is_dead(src_adrs + src_ndx, segment) ) {	//  L1 never dead
-				cash->cntrs[segment][BYT_RES][DEAD_WR]++;
-				blk_dead = 1;
-				lmt_dead = 1;
-				sub_dead = 1;
-			} else if ( src_valid == 1  &&  dst_valid == 1  &&  src_data == dst_data) {
-				cash->cntrs[segment][BYT_RES][DUST_WR]++;
-				blk_dusty = 1;
-				lmt_dusty = 1;
-				sub_dusty = 1;
-			} else if (dst->stat[dst_ndx] & CBLSTWR) {
-				cash->cntrs[segment][BYT_RES][USLS_WR]++;
-				blk_usls = 1;
-				lmt_usls = 1;
-				sub_usls = 1;
-			} else {
-				cash->cntrs[segment][BYT_RES][LIVE_WR]++;
-				blk_live = 1;
-				lmt_live = 1;
-				sub_live = 1;
-			}
-			dst->data[dst_ndx] = data[src_ndx];
-			dst->stat[dst_ndx] = (dst->stat[dst_ndx] & CBLSTMSK)  | CBLSTWR;		//	mark last access WR
+		//	a sub-block ends at the last byte of each sub_size bytes of address or of the transfer
+		sub_ends = 0;
+		for (i = sub_size - 1 - (src_adrs + grp) % sub_size; i < n; i += sub_size) {
+			sub_ends |= 1ULL << i;
 		}
-
-		//	update orig field if destination not already valid and source is valid, then mark as valid
-		if (dst_valid == 0  &&  src_valid) {
-			dst->orig[dst_ndx] = orig[src_ndx];
-			dst->stat[dst_ndx] = dst->stat[dst_ndx] | CBVALID;
+		if (grp + n == size) {
+			sub_ends |= 1ULL << (n - 1);
 		}
-		dst->data[dst_ndx] = data[src_ndx];				//	copy current data
 		
-		//	update element counters if an element start was processed AND
-		//	(this byte is the last byte of the access {src_ndx + 1 == size}
-		//		OR  this byte is the last byte of the element (next byte is element start)
-		//			{src_ndx + 1 < size  AND  stat[src_ndx+1] & CBLEMNT is true} )
-		//	reset element start flag here, element count flags get reset at top of loop on next byte
-		if (lmt_flag != 0  &&  ( src_ndx+1 == size  ||
-			( (src_ndx + 1 < size)  &&  (stat[src_ndx+1] & CBLEMNT) ) ) ) {
-			//	do not allow elements to be of mixed types
-			if (lmt_read) {
-				cash->cntrs[segment][LMT_RES][READ_ACS]++;
-			} else if (lmt_dead) {
-				cash->cntrs[segment][LMT_RES][DEAD_WR]++;
-			} else if (lmt_live) {
-				cash->cntrs[segment][LMT_RES][LIVE_WR]++;
-			} else if (lmt_dusty) {
-				cash->cntrs[segment][LMT_RES][DUST_WR]++;
-			} else if (lmt_usls) {
-				cash->cntrs[segment][LMT_RES][USLS_WR]++;
-			} else if (lmt_untouch) {
-				cash->cntrs[segment][LMT_RES][UNTOUCH]++;
-			}
-			lmt_flag = 0;
+		if (read) {
+			cntr[BYT_RES][READ_ACS] += n;
+			cntr[LMT_RES][READ_ACS] += __builtin_popcountll(m.lmnt);
+			cntr[SUB_RES][READ_ACS] += __builtin_popcountll(sub_ends);
+			continue;
 		}
 		
-		//	update sub-block counters if this byte is last byte of a sub-block
-		//	use (src_adrs + src_ndx) in case mr->adrs starts in middle of sub-block
-		//  reset flags here
-		if ( ( (src_adrs + src_ndx) % sub_size == sub_size-1)		//	end of sub-block
-			|| (src_ndx + 1 == size) ) {							//	or last byte of transaction
-			if (sub_read) {
-				cash->cntrs[segment][SUB_RES][READ_ACS]++;
-			} else if (sub_dead + sub_dusty + sub_untouch >= 1)	{	//	mixed wasted write
-				cash->cntrs[segment][SUB_RES][MIXD_WR]++;
-			} else if (sub_dead == 1) {
-				cash->cntrs[segment][SUB_RES][DEAD_WR]++;
-			} else if (sub_dusty == 1) {
-				cash->cntrs[segment][SUB_RES][DUST_WR]++;
-			} else if (sub_live == 1) {
-				cash->cntrs[segment][SUB_RES][LIVE_WR]++;
-			} else if (sub_usls == 1) {
-				cash->cntrs[segment][SUB_RES][USLS_WR]++;
-			} else {
-				cash->cntrs[segment][SUB_RES][UNTOUCH]++;
+		//	classify the bytes of a write, each byte is in exactly one of the masks
+		untouch = ~m.src_valid & ((n < 64) ? (1ULL << n) - 1 : ~0ULL);
+		dead = 0;
+		if (cash->level != 1) {										//  L1 never dead
+			for (i = 0; i < n; i++) {
+				if (((m.src_valid >> i) & 1)  &&  is_dead(src_adrs + grp + i, segment)) {
+					dead |= 1ULL << i;
+				}
 			}
-			sub_dead = 0;
-			sub_dusty = 0;
-			sub_live = 0;
-			sub_read = 0;
-			sub_untouch = 0;
-			sub_usls = 0;
 		}
+		dusty = m.src_valid & ~dead & m.dst_valid & m.same;
+		usls = m.src_valid & ~dead & ~dusty & m.last_wr;
+		live = m.src_valid & ~dead & ~dusty & ~usls;
+		cntr[BYT_RES][UNTOUCH] += __builtin_popcountll(untouch);
+		cntr[BYT_RES][DEAD_WR] += __builtin_popcountll(dead);
+		cntr[BYT_RES][DUST_WR] += __builtin_popcountll(dusty);
+		cntr[BYT_RES][USLS_WR] += __builtin_popcountll(usls);
+		cntr[BYT_RES][LIVE_WR] += __builtin_popcountll(live);
+		
+		//	elements, do not allow elements to be of mixed types
+		h_dead = seg_hits(dead & lmt_on, lmt_ends, &lmt_carry[0]);
+		h_live = seg_hits(live & lmt_on, lmt_ends, &lmt_carry[1]);
+		h_dusty = seg_hits(dusty & lmt_on, lmt_ends, &lmt_carry[2]);
+		h_usls = seg_hits(usls & lmt_on, lmt_ends, &lmt_carry[3]);
+		h_untouch = seg_hits(untouch & lmt_on, lmt_ends, &lmt_carry[4]);
+		cntr[LMT_RES][DEAD_WR] += __builtin_popcountll(h_dead);
+		h_live &= ~h_dead;
+		cntr[LMT_RES][LIVE_WR] += __builtin_popcountll(h_live);
+		h_dusty &= ~(h_dead | h_live);
+		cntr[LMT_RES][DUST_WR] += __builtin_popcountll(h_dusty);
+		h_usls &= ~(h_dead | h_live | h_dusty);
+		cntr[LMT_RES][USLS_WR] += __builtin_popcountll(h_usls);
+		cntr[LMT_RES][UNTOUCH] += __builtin_popcountll(h_untouch & ~(h_dead | h_live | h_dusty | h_usls));
+		
+		//	sub-blocks, a dead, dusty, or untouched byte makes a mixed wasted write
+		h_dead = seg_hits(dead | dusty | untouch, sub_ends, &sub_carry[0]);
+		h_live = seg_hits(live, sub_ends, &sub_carry[1]) & ~h_dead;
+		h_usls = seg_hits(usls, sub_ends, &sub_carry[2]) & ~(h_dead | h_live);
+		cntr[SUB_RES][MIXD_WR] += __builtin_popcountll(h_dead);
+		cntr[SUB_RES][LIVE_WR] += __builtin_popcountll(h_live);
+		cntr[SUB_RES][USLS_WR] += __builtin_popcountll(h_usls);
+		cntr[SUB_RES][UNTOUCH] += __builtin_popcountll(sub_ends & ~(h_dead | h_live | h_usls));
 		
-	}	//	end for of source bytes
+		blk_any[0] |= dead | dusty | untouch;
+		blk_any[1] |= live;
+		blk_any[2] |= usls;
+	}	//	end for of source byte groups
 	
-	//	update block counters, no need to reset flags
-	if (blk_read) {
-		cash->cntrs[segment][BLK_RES][READ_ACS]++;
-	} else if (blk_dead + blk_dusty + blk_untouch >= 1)	{	//	mixed wasted write
-		cash->cntrs[segment][BLK_RES][MIXD_WR]++;
-	} else if (blk_dead == 1) {
-		cash->cntrs[segment][BLK_RES][DEAD_WR]++;
-	} else if (blk_dusty == 1) {
-		cash->cntrs[segment][BLK_RES][DUST_WR]++;
-	} else if (blk_live == 1) {
-		cash->cntrs[segment][BLK_RES][LIVE_WR]++;
-	} else if (blk_usls == 1) {
-		cash->cntrs[segment][BLK_RES][USLS_WR]++;
+	//	update block counters
+	if (read) {
+		cntr[BLK_RES][READ_ACS]++;
+	} else if (blk_any[0]) {									//	mixed wasted write
+		cntr[BLK_RES][MIXD_WR]++;
+	} else if (blk_any[1]) {
+		cntr[BLK_RES][LIVE_WR]++;
+	} else if (blk_any[2]) {
+		cntr[BLK_RES][USLS_WR]++;
 	} else {
-		cash->cntrs[segment][BLK_RES][UNTOUCH]++;
+		cntr[BLK_RES][UNTOUCH]++;
 	}
 	//	update cache line status  TBD logic for subblocks needed
 	dst->valid |= valid;
+	CL_SET_TAG(dst);
 	if (oper == MRWRITE) {
 		dst->dirty |= 1;
 	} else {
@@ -1917,39 +2248,37 @@ void		update_cl(memref *mr, cacheline *cl, cacheline *dst) {
  int32_t		n;				//	loop index for the lines
  
  nmbr_lines = set->owner->assoc;
- cl = set->mru;
  for (n = 0; n < nmbr_lines; n++) {
- cl->adrs = tagadrs + n;
- cl = cl->lru;
+ rank_find(set, n)->adrs = tagadrs + n;
  }
  print_set(set);
- cl = set->mru->lru->lru->lru;
+ cl = rank_find(set, 3);
  move2_lru(set, cl);
  print_set(set);
  move2_mru(set, cl);
  print_set(set);
- move2_mru(set, set->mru);
+ move2_mru(set, rank_find(set, 0));
  print_set(set);
- move2_lru(set, set->mru);
+ move2_lru(set, rank_find(set, 0));
  print_set(set);
- move2_mru(set, set->lru);
+ move2_mru(set, rank_find(set, nmbr_lines - 1));
  print_set(set);
- move2_lru(set, set->lru);
+ move2_lru(set, rank_find(set, nmbr_lines - 1));
  print_set(set);
- cl = set->mru->lru;
+ cl = rank_find(set, 1);
  move2_lru(set, cl);
  print_set(set);
- cl = set->mru->lru;
+ cl = rank_find(set, 1);
  move2_mru(set, cl);
  print_set(set);
- cl = set->lru->mru;
+ cl = rank_find(set, nmbr_lines - 2);
  move2_lru(set, cl);
  print_set(set);
- cl = set->lru->mru;
+ cl = rank_find(set, nmbr_lines - 2);
  move2_mru(set, cl);
  print_set(set);
  
- cl = set->lru->mru;
+ cl = rank_find(set, nmbr_lines - 2);
  
  //	end of move2_lru() and move2_mru() test code
  */
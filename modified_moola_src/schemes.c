@@ -0,0 +1,269 @@
+//
+//  schemes.c  (multi-scheme set mapping evaluation for Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "moola.h"
+
+
+//	"schemes.c" implements the '-schemes' option.  The cache hierarchy is simulated once with
+//	the first scheme of the list, which also produces the normal leakage results.  Each other
+//	scheme gets a run with its own set_map and leakage state that sees the same line addresses
+//	as the data caches of the '-cache_test' level, so one pass over the trace gives the
+//	Results_average_* and Results_by_set_* files of every scheme.
+//
+//	reference() passes each line address to schemes_add, which collects them in batches.  A
+//	full batch is published to the worker threads, one for each run, which map the addresses
+//	and accumulate the leakage statistics while the main thread fills the other batch.  The
+//	main thread only writes 'published' and each worker only writes its 'done' count, so no
+//	locks are needed.  schemes_sync waits for the workers to finish every published address;
+//	it is called before the DES key changes so that each address is mapped with the key that
+//	was in use when it was referenced.
+
+
+#define SW_BATCH 4096			//	number of line addresses in a batch
+#define SW_SPINS 64				//	number of sched_yield() spins before sleeping while waiting
+
+typedef struct sw_batch_rec {
+	int32_t		count;				//	number of valid line addresses in this batch
+	uint64_t	lines[SW_BATCH];	//	line addresses of this batch
+} sw_batch;
+
+typedef struct sw_run_rec {
+	set_map		map;			//	set mapping of the scheme of this run
+	struct sets	*mysets;		//	leakage state of each set for this scheme
+	FILE		*avg_f;			//	Results_average_* file of this scheme
+	FILE		*set_f;			//	Results_by_set_* file of this scheme
+	pthread_t	thread;			//	worker thread of this run
+	atomic_uint	done;			//	number of batches completed by the worker
+} sw_run;
+
+
+//	The following variables are static to functions in this file
+static sw_batch		batches[2];		//	batch being filled and batch being processed
+static sw_run		*runs;			//	run for schemes[1] .. schemes[nmbr_schemes-1]
+static int32_t		nmbr_runs;		//	number of runs
+static atomic_uint	published;		//	number of batches published to the workers
+static atomic_int	stop;			//	set by the main thread to stop the workers
+static int16_t		started;		//	set once the worker threads are running
+
+
+
+//	sw_wait		back off while there is nothing to do
+//	'spins' counts the calls for this wait, the first SW_SPINS calls only yield the processor
+static void sw_wait(int32_t *spins) {
+	struct timespec	ts;			//	sleep time once spinning has not helped
+
+	if ((*spins)++ < SW_SPINS) {
+		sched_yield();
+	} else {
+		ts.tv_sec = 0;
+		ts.tv_nsec = 20000;
+		nanosleep(&ts, NULL);
+	}
+	return;
+}
+
+
+
+//	sw_worker	thread function that maps the published batches for the run 'arg'
+static void *sw_worker(void *arg) {
+	sw_run		*run;			//	run of this thread
+	sw_batch	*batch;			//	batch being processed
+	uint32_t	done;			//	local copy of the completed batch count
+	int32_t		spins;			//	back off count while no batch is published
+	int32_t		set;			//	set number of a line address
+	int32_t		i;
+
+	run = (sw_run *) arg;
+	done = 0;
+	while (1) {
+		spins = 0;
+		while (atomic_load_explicit(&published, memory_order_acquire) == done) {
+			if (atomic_load_explicit(&stop, memory_order_relaxed)) {
+				return NULL;
+			}
+			sw_wait(&spins);
+		}
+		batch = &batches[done & 1];
+		for (i = 0; i < batch->count; i++) {
+			set = run->map.fn(&run->map, batch->lines[i]);
+			estimatePs(&run->mysets[set], batch->lines[i]);
+		}
+		done++;
+		atomic_store_explicit(&run->done, done, memory_order_release);
+	}
+}
+
+
+
+//	sw_wait_done	wait until every worker has completed 'count' batches
+static void sw_wait_done(uint32_t count) {
+	int32_t		spins;			//	back off count while a worker is busy
+	int32_t		r;
+
+	for (r = 0; r < nmbr_runs; r++) {
+		spins = 0;
+		while (atomic_load_explicit(&runs[r].done, memory_order_acquire) < count) {
+			sw_wait(&spins);
+		}
+	}
+	return;
+}
+
+
+
+//	sw_publish	hand the batch being filled to the workers and start filling the other batch
+static void sw_publish(void) {
+	uint32_t	pub;			//	number of batches published before this one
+
+	pub = atomic_load_explicit(&published, memory_order_relaxed);
+	atomic_store_explicit(&published, pub + 1, memory_order_release);
+	sw_wait_done(pub);			//	the other batch was used by batch pub - 1
+	batches[(pub + 1) & 1].count = 0;
+	return;
+}
+
+
+
+//	sw_start	create the runs for caches of 'nmbr_sets' sets and start their worker threads
+static void sw_start(int32_t nmbr_sets) {
+	int32_t		r;
+
+	for (r = 0; r < nmbr_runs; r++) {
+		init_map(&runs[r].map, schemes[r + 1], nmbr_sets);
+		runs[r].mysets = calloc(nmbr_sets, sizeof(struct sets));
+		if (runs[r].mysets == NULL) {
+			error("Unable to allocate memory for the -schemes leakage statistics", -10);
+		}
+		atomic_store(&runs[r].done, 0);
+	}
+	atomic_store(&published, 0);
+	atomic_store(&stop, 0);
+	batches[0].count = 0;
+	for (r = 0; r < nmbr_runs; r++) {
+		if (pthread_create(&runs[r].thread, NULL, sw_worker, &runs[r]) != 0) {
+			error("Unable to start a -schemes worker thread", -10);
+		}
+	}
+	started = 1;
+	return;
+}
+
+
+
+//	schemes_open	open the Results files of schemes[1] and after, named from 'name' and the scheme
+//	returns 0 for success, -1 if a file could not be opened
+int32_t schemes_open(char *name) {
+	char		*fname;			//	file name being opened
+	int32_t		r;
+
+	nmbr_runs = nmbr_schemes - 1;
+	if (nmbr_runs <= 0) {
+		return 0;
+	}
+	runs = calloc(nmbr_runs, sizeof(sw_run));
+	fname = malloc(strlen(name) + 40);
+	if (runs == NULL  ||  fname == NULL) {
+		error("Unable to allocate memory for the -schemes runs", -10);
+	}
+	for (r = 0; r < nmbr_runs; r++) {
+		sprintf(fname, "Results_average_%s_s%d.csv", name, schemes[r + 1]);
+		runs[r].avg_f = fopen(fname, "w");
+		if (runs[r].avg_f == NULL) {
+			printf("ERROR:  could not open %s for writing\n", fname);
+			return -1;
+		}
+		sprintf(fname, "Results_by_set_%s_s%d.csv", name, schemes[r + 1]);
+		runs[r].set_f = fopen(fname, "w");
+		if (runs[r].set_f == NULL) {
+			printf("ERROR:  could not open %s for writing\n", fname);
+			return -1;
+		}
+	}
+	free(fname);
+	return 0;
+}
+
+
+
+//	schemes_add		add the line address 'a' referenced in the cache_test cache 'cash' to each run
+void schemes_add(cache *cash, uint64_t a) {
+	sw_batch	*batch;			//	batch being filled
+
+	if (!started) {
+		sw_start(cash->nmbr_sets);
+	}
+	batch = &batches[atomic_load_explicit(&published, memory_order_relaxed) & 1];
+	batch->lines[batch->count++] = a;
+	if (batch->count == SW_BATCH) {
+		sw_publish();
+	}
+	return;
+}
+
+
+
+//	schemes_sync	wait until the workers have mapped every line address added so far
+void schemes_sync(void) {
+	if (!started) {
+		return;
+	}
+	if (batches[atomic_load_explicit(&published, memory_order_relaxed) & 1].count > 0) {
+		sw_publish();
+	}
+	sw_wait_done(atomic_load_explicit(&published, memory_order_relaxed));
+	return;
+}
+
+
+
+//	schemes_finish	stop the workers and write the Results files of each run for 'set_lines' sets
+void schemes_finish(int set_lines) {
+	int32_t		r;
+
+	if (nmbr_runs <= 0) {
+		return;
+	}
+	if (started) {
+		schemes_sync();
+		atomic_store(&stop, 1);
+		for (r = 0; r < nmbr_runs; r++) {
+			pthread_join(runs[r].thread, NULL);
+		}
+		started = 0;
+	}
+	for (r = 0; r < nmbr_runs; r++) {
+		compute_entropies(runs[r].mysets, set_lines);
+		print_results(runs[r].avg_f, runs[r].set_f, runs[r].mysets, schemes[r + 1], set_lines);
+		fclose(runs[r].avg_f);
+		fclose(runs[r].set_f);
+	}
+	return;
+}
@@ -0,0 +1,186 @@
+//
+//  symbols.c  (interned Gleipnir symbol names for Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "moola.h"
+
+
+//	"symbols.c" keeps one copy of each function and variable name read from Gleipnir traces.
+//	A memref holds the 32-bit ID of its names instead of the name strings, which keeps the
+//	record small enough to copy cheaply into the processor queues.  symbol_name() returns the
+//	string for an ID; print_mr() in utils.c uses it to print the function and variable names of
+//	a Gleipnir reference when compiled with GLEIPNIR.
+//
+//	The IDs index 'names' in the order the names were first seen.  'slots' is an open
+//	addressing hash table of IDs, kept at most half full.  The gleipnir parse threads of
+//	different files intern names at the same time, so the table is protected by 'sym_lock'.
+//	Each thread looks a name up first in its own 'sym_cache', a small direct mapped table of
+//	the names it interned recently, and takes the lock only when the name is not there.  The
+//	name strings are never moved or freed, so a cache entry can point at one without the lock.
+//	The fixed names used by the gleipnir reader are interned first so that their IDs are the
+//	SYM_* constants of moola.h.
+
+
+//	The following variables are static to functions in this file
+static pthread_mutex_t	sym_lock = PTHREAD_MUTEX_INITIALIZER;	//	protects all of the table
+static char		**names;			//	name string of each ID
+static int32_t	nmbr_names;			//	number of IDs assigned
+static int32_t	max_names;			//	number of entries allocated for names
+static int32_t	*slots;				//	hash table of IDs, -1 => empty slot
+static uint32_t	nmbr_slots;			//	number of slots, a power of 2
+
+//	per thread cache of recently interned names
+#define SYM_CACHE 512				//	number of entries in a sym_cache, a power of 2
+
+typedef struct sym_cache_rec sym_cache_entry;
+struct sym_cache_rec {
+	char		*name;				//	interned name string, NULL => empty entry
+	uint32_t	hash;				//	sym_hash of the name
+	int32_t		id;					//	ID of the name
+};
+static __thread sym_cache_entry	sym_cache[SYM_CACHE];
+
+//	the names of the SYM_* constants, in ID order
+static char		*fixed_names[] = {"", "_unknown_", "_global_", "_heap_", "_instruction_", "_stack_", NULL};
+
+
+
+//	sym_hash	FNV-1a hash of the 'len' characters at 'name'
+static uint32_t sym_hash(char *name, int32_t len) {
+	uint32_t	h;
+	int32_t		i;
+
+	h = 2166136261u;
+	for (i = 0; i < len; i++) {
+		h = (h ^ (uint8_t) name[i]) * 16777619u;
+	}
+	return h;
+}
+
+
+
+//	sym_grow	double the size of the hash table and rehash the assigned IDs
+static void sym_grow(void) {
+	int32_t		id;
+	uint32_t	s;
+
+	free(slots);
+	nmbr_slots = nmbr_slots ? 2 * nmbr_slots : 1024;
+	slots = malloc(nmbr_slots * sizeof(int32_t));
+	if (slots == NULL) {
+		error("Unable to allocate memory for the symbol table", -10);
+	}
+	memset(slots, 0xff, nmbr_slots * sizeof(int32_t));
+	for (id = 0; id < nmbr_names; id++) {
+		s = sym_hash(names[id], strlen(names[id])) & (nmbr_slots - 1);
+		while (slots[s] >= 0) {
+			s = (s + 1) & (nmbr_slots - 1);
+		}
+		slots[s] = id;
+	}
+	return;
+}
+
+
+
+//	sym_add		find or add the name of 'len' characters at 'name' with sym_hash 'h', called
+//	with sym_lock held.  returns the ID of the name
+static int32_t sym_add(char *name, int32_t len, uint32_t h) {
+	uint32_t	s;				//	hash table slot
+	int32_t		id;
+
+	if (2 * (uint32_t) (nmbr_names + 1) > nmbr_slots) {
+		sym_grow();
+	}
+	s = h & (nmbr_slots - 1);
+	while ((id = slots[s]) >= 0) {
+		if (strncmp(names[id], name, len) == 0  &&  names[id][len] == '\0') {
+			return id;
+		}
+		s = (s + 1) & (nmbr_slots - 1);
+	}
+	if (nmbr_names == max_names) {
+		max_names = max_names ? 2 * max_names : 1024;
+		names = realloc(names, max_names * sizeof(char *));
+		if (names == NULL) {
+			error("Unable to allocate memory for the symbol names", -10);
+		}
+	}
+	id = nmbr_names++;
+	names[id] = malloc(len + 1);
+	if (names[id] == NULL) {
+		error("Unable to allocate memory for a symbol name", -10);
+	}
+	memcpy(names[id], name, len);
+	names[id][len] = '\0';
+	slots[s] = id;
+	return id;
+}
+
+
+
+//	intern_symbol	returns the ID of the 'len' character name at 'name', adding it if it is new
+int32_t intern_symbol(char *name, int32_t len) {
+	sym_cache_entry	*e;			//	entry of this thread's cache for the name
+	uint32_t	h;				//	hash of the name
+	int32_t		i;
+	int32_t		id;
+
+	h = sym_hash(name, len);
+	e = &sym_cache[h & (SYM_CACHE - 1)];
+	if (e->name != NULL  &&  e->hash == h  &&  strncmp(e->name, name, len) == 0  &&  e->name[len] == '\0') {
+		return e->id;
+	}
+	pthread_mutex_lock(&sym_lock);
+	if (nmbr_names == 0) {
+		for (i = 0; fixed_names[i] != NULL; i++) {
+			sym_add(fixed_names[i], strlen(fixed_names[i]), sym_hash(fixed_names[i], strlen(fixed_names[i])));
+		}
+	}
+	id = sym_add(name, len, h);
+	e->name = names[id];
+	pthread_mutex_unlock(&sym_lock);
+	e->hash = h;
+	e->id = id;
+	return id;
+}
+
+
+
+//	symbol_name		returns the name string of symbol 'id'
+char *symbol_name(int32_t id) {
+	char		*name;
+
+	pthread_mutex_lock(&sym_lock);
+	if (id < 0  ||  id >= nmbr_names) {
+		name = (id >= 0  &&  id <= SYM_STACK) ? fixed_names[id] : "";	//	nothing interned yet
+	} else {
+		name = names[id];
+	}
+	pthread_mutex_unlock(&sym_lock);
+	return name;
+}
@@ -0,0 +1,339 @@
+//
+//  trace_cache.c  (cached binary sidecars of text trace files for Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "moola.h"
+
+
+//	"trace_cache.c" implements the '-trace_cache' option.  The trace access functions selected
+//	by '-informat' are wrapped so that the first run over a text trace file writes a moola_blk
+//	copy of the decoded records next to it (the "sidecar", named <trace file>.mcache) while
+//	the simulation runs.  Later runs find the sidecar and memory map it in place of inflating
+//	and parsing the trace file again.
+//
+//	A sidecar ends with an mcache_key trailer after the moola_blk index, which the moola_blk
+//	reader never looks at.  The key holds the size, modification time, and a hash of the first
+//	and last CACHE_HASH_LEN bytes of the trace file plus the -informat name, and the sidecar
+//	is only used if all of them match.  The sidecar is written to a temporary name and renamed
+//	once the end of the trace file is reached, so an interrupted run or a second run writing
+//	the same sidecar never leaves a partial file behind.
+//
+//	The text readers do not restart their line numbers when a '-unicore' file is reopened for
+//	another repetition.  The key records the number of lines in the trace file so the line
+//	numbers read from the sidecar can be continued the same way.
+
+
+#define CACHE_HASH_LEN (1 << 20)	//	bytes hashed at each end of the trace file
+
+typedef struct tc_fil_rec {
+	mbin_wrtr	wr;				//	writer for the sidecar being written
+	mcache_key	key;			//	key of the trace file
+	char		*side;			//	name of the sidecar
+	char		*tmp;			//	name the sidecar is written under until it is complete
+	int64_t		line_ofs;		//	added to the sidecar line numbers for repeated passes
+	int16_t		cached;			//	1 => records are read from the sidecar
+	int16_t		writing;		//	1 => records are being written to the sidecar
+} tc_fil;
+
+
+//	The following variables are static to functions in this file
+static void		(*base_close)(int16_t);				//	close function of the selected format
+static int32_t	(*base_open)(int16_t);				//	open function of the selected format
+static int32_t	(*base_read)(int16_t, memref *);	//	read function of the selected format
+static int32_t	(*base_reopen)(int16_t);			//	reopen function of the selected format
+static int16_t	has_data;							//	1 => the format provides data values
+static tc_fil	*tcs;								//	state for each input file, 'in_filcnt' entries
+
+//	formats that can be cached, only the text formats with parse_ctx line numbers qualify
+static char		*cache_formats[] = {"moola", "moola_gz", "moola_value", "moola_valuegz", "pin", "pin_gz", NULL};
+
+
+
+//	tc_hash		add 'len' bytes at 'buf' to the FNV-1a hash 'h'
+static uint64_t tc_hash(uint64_t h, uint8_t *buf, size_t len) {
+	size_t		i;
+
+	for (i = 0; i < len; i++) {
+		h = (h ^ buf[i]) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+
+
+//	tc_key		fill in 'key' for the trace file 'fndx'
+//	returns 0 if the trace file cannot be examined, 1 for success
+static int32_t tc_key(int16_t fndx, mcache_key *key) {
+	FILE		*fil;			//	trace file
+	struct stat	st;				//	size and modification time of the trace file
+	uint8_t		*buf;			//	bytes read for the hash
+	size_t		len;			//	number of bytes read
+	uint64_t	h;				//	hash being accumulated
+
+	if (stat(in_fnames[fndx], &st) != 0) {
+		return 0;
+	}
+	fil = fopen(in_fnames[fndx], "rb");
+	buf = malloc(CACHE_HASH_LEN);
+	if (fil == NULL  ||  buf == NULL) {
+		if (fil != NULL)	fclose(fil);
+		free(buf);
+		return 0;
+	}
+	h = 0xcbf29ce484222325ULL;
+	len = fread(buf, 1, CACHE_HASH_LEN, fil);
+	h = tc_hash(h, buf, len);
+	if (st.st_size > 2 * CACHE_HASH_LEN  &&  fseeko(fil, st.st_size - CACHE_HASH_LEN, SEEK_SET) == 0) {
+		len = fread(buf, 1, CACHE_HASH_LEN, fil);
+		h = tc_hash(h, buf, len);
+	}
+	fclose(fil);
+	free(buf);
+
+	memset(key, 0, sizeof(mcache_key));
+	memcpy(key->magic, MCACHE_MAGIC, 8);
+	key->src_size = st.st_size;
+	key->src_mtime = st.st_mtime;
+	key->src_hash = h;
+	strncpy(key->informat, in_format, sizeof(key->informat) - 1);
+	return 1;
+}
+
+
+
+//	tc_check	check whether the sidecar of file 'fndx' exists and matches the trace file
+//	the line count of a matching sidecar is copied into the file's key
+//	returns 1 if the sidecar can be used, 0 otherwise
+static int32_t tc_check(int16_t fndx) {
+	tc_fil		*tf;			//	state of this file
+	FILE		*fil;			//	sidecar file
+	mcache_key	key;			//	key at the end of the sidecar
+
+	tf = &tcs[fndx];
+	fil = fopen(tf->side, "rb");
+	if (fil == NULL) {
+		return 0;
+	}
+	if (fseeko(fil, -(off_t) sizeof(mcache_key), SEEK_END) != 0  ||  fread(&key, sizeof(key), 1, fil) != 1) {
+		fclose(fil);
+		return 0;
+	}
+	fclose(fil);
+	if (memcmp(key.magic, tf->key.magic, 8) != 0  ||  key.src_size != tf->key.src_size
+			||  key.src_mtime != tf->key.src_mtime  ||  key.src_hash != tf->key.src_hash
+			||  strncmp(key.informat, tf->key.informat, sizeof(key.informat)) != 0) {
+		return 0;
+	}
+	tf->key.src_lines = key.src_lines;
+	return 1;
+}
+
+
+
+//	tc_abandon	stop writing the sidecar of file 'fndx' and remove the partial file
+static void tc_abandon(int16_t fndx) {
+	tc_fil		*tf;			//	state of this file
+
+	tf = &tcs[fndx];
+	trace_finish_moola_bin(&tf->wr);
+	unlink(tf->tmp);
+	tf->writing = 0;
+	return;
+}
+
+
+
+//	tc_complete		finish the sidecar of file 'fndx' at the end of the trace file, add the key
+//	trailer, and give it its final name
+static void tc_complete(int16_t fndx) {
+	tc_fil		*tf;			//	state of this file
+	FILE		*fil;			//	sidecar opened to append the key
+
+	tf = &tcs[fndx];
+	tf->writing = 0;
+	tf->key.src_lines = parse_ctxs[fndx]->lineno;
+	if (trace_finish_moola_bin(&tf->wr) == 0) {
+		unlink(tf->tmp);
+		return;
+	}
+	fil = fopen(tf->tmp, "ab");
+	if (fil == NULL) {
+		unlink(tf->tmp);
+		return;
+	}
+	if (fwrite(&tf->key, sizeof(mcache_key), 1, fil) != 1  ||  fclose(fil) != 0
+			||  rename(tf->tmp, tf->side) != 0) {
+		unlink(tf->tmp);
+		return;
+	}
+	printf("Wrote trace cache '%s'.\n", tf->side);
+	return;
+}
+
+
+
+//	trace_cache_init	replace the trace access function pointers selected by '-informat'
+//	with the caching versions in this file.  Called once after configuration.
+void trace_cache_init(void) {
+	int16_t		i;
+	int16_t		fndx;
+	size_t		len;			//	length of a trace file name
+
+	for (i = 0; in_format != NULL  &&  cache_formats[i] != NULL; i++) {
+		if (strcmp(cache_formats[i], in_format) == 0) {
+			break;
+		}
+	}
+	if (in_format == NULL  ||  cache_formats[i] == NULL) {
+		printf("'-trace_cache' does not apply to '-informat %s', the trace is read directly.\n",
+			   in_format ? in_format : "");
+		return;
+	}
+	has_data = (strstr(in_format, "value") != NULL);
+	tcs = calloc(in_filcnt, sizeof(tc_fil));
+	if (tcs == NULL) {
+		error("Unable to allocate memory for trace cache state", -10);
+	}
+	for (fndx = 0; fndx < in_filcnt; fndx++) {
+		len = strlen(in_fnames[fndx]);
+		tcs[fndx].side = malloc(len + 8);
+		tcs[fndx].tmp = malloc(len + 40);
+		if (tcs[fndx].side == NULL  ||  tcs[fndx].tmp == NULL) {
+			error("Unable to allocate memory for trace cache names", -10);
+		}
+		sprintf(tcs[fndx].side, "%s.mcache", in_fnames[fndx]);
+		sprintf(tcs[fndx].tmp, "%s.mcache.tmp%ld", in_fnames[fndx], (long) getpid());
+	}
+
+	base_close = trace_close;
+	base_open = trace_open;
+	base_read = trace_read;
+	base_reopen = trace_reopen;
+	trace_close = trace_close_cache;
+	trace_open = trace_open_cache;
+	trace_read = trace_read_cache;
+	trace_reopen = trace_reopen_cache;
+	return;
+}
+
+
+
+//  function to close a cached trace file
+//	an incomplete sidecar is removed
+void trace_close_cache(int16_t fndx) {
+	if (tcs[fndx].cached) {
+		trace_close_moola_blk(fndx);
+		return;
+	}
+	if (tcs[fndx].writing) {
+		tc_abandon(fndx);
+	}
+	base_close(fndx);
+	return;
+}
+
+
+
+//  function to open a cached trace file
+//	the sidecar is used when it matches the trace file, otherwise the trace file is opened with
+//	the format open function and a new sidecar is started
+//	returns 0 for error, 1 for success
+int32_t trace_open_cache(int16_t fndx) {
+	tc_fil		*tf;			//	state of this file
+
+	tf = &tcs[fndx];
+	tf->cached = 0;
+	tf->writing = 0;
+	tf->line_ofs = 0;
+	if (tc_key(fndx, &tf->key) == 0) {
+		return base_open(fndx);				//	let the format report the problem
+	}
+	if (tc_check(fndx)  &&  trace_open_moola_blk_file(fndx, tf->side)) {
+		printf("Reading trace cache '%s' for '%s'.\n", tf->side, in_fnames[fndx]);
+		tf->cached = 1;
+		return 1;
+	}
+	if (base_open(fndx) == 0) {
+		return 0;
+	}
+	if (trace_create_moola_bin(&tf->wr, tf->tmp, 1, has_data)) {
+		tf->writing = 1;
+	} else {
+		printf("Continuing without a trace cache for '%s'.\n", in_fnames[fndx]);
+	}
+	return 1;
+}
+
+
+
+//  function to reopen a cached trace file for another repetition
+//	returns 0 for error, 1 for success
+int32_t trace_reopen_cache(int16_t fndx) {
+	tc_fil		*tf;			//	state of this file
+
+	tf = &tcs[fndx];
+	if (tf->cached) {
+		tf->line_ofs += tf->key.src_lines;
+		return trace_open_moola_blk_file(fndx, tf->side);
+	}
+	if (tc_check(fndx)  &&  trace_open_moola_blk_file(fndx, tf->side)) {
+		tf->line_ofs = parse_ctxs[fndx]->lineno;	//	lines read by the earlier passes
+		tf->cached = 1;
+		return 1;
+	}
+	return base_reopen(fndx);
+}
+
+
+
+//  The trace_read_cache function reads the next record from the sidecar or from the trace file.
+//	Records read from the trace file are also written to the sidecar, which is completed when
+//	the end of the trace file is reached.
+//  0 is returned if the end of file was reached, 1 is returned for a valid record
+
+int32_t trace_read_cache(int16_t fndx, memref *mr) {
+	tc_fil		*tf;			//	state of this file
+	int32_t		stat;			//	status from the read function
+
+	tf = &tcs[fndx];
+	if (tf->cached) {
+		stat = trace_read_moola_blk(fndx, mr);
+		mr->linenmbr += tf->line_ofs;
+		return stat;
+	}
+	stat = base_read(fndx, mr);
+	if (tf->writing) {
+		if (stat <= 0) {
+			tc_complete(fndx);
+		} else if (trace_write_moola_bin(&tf->wr, mr) == 0) {
+			printf("Unable to write trace cache '%s', continuing without it.\n", tf->tmp);
+			tc_abandon(fndx);
+		}
+	}
+	return stat;
+}
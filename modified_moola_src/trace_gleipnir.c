@@ -80,28 +80,16 @@
 
 
 
-//	The following variables are either static or global to functions in this file
-//  The global data is required for the in-line functions and source macros to operate properly
-//	The static data is required for maintaining state information between calls to the functions
-uint8_t		*bytes;			//	pointer to data value bytes (function global)
-int16_t		bndx;			//	index to the current byte of data (function global)
-char		c;				//  character from input trace file (function global)
-char		*cptr;			//	pointer to next character in ibfr (function global)
-int16_t		crntfndx;		//	current file index for use by sub function error reporting (function global)
-gzFile		*gzfil[8];		//	pointers to gzipped trace files for input (static)
-char		ibfr[600];		//	buffer for input, 160 should be long enough for each line (function global)
-int64_t		in_lineno[8];	//	line number of most recently read line in the files (static)
-FILE		*txtfil[8];		//	pointers to text trace files for input (static)
-int64_t		val;			//	temporary generation of an input value (function global)
+//	The parser state for each input file is kept in its parse_ctx, see get_parse_ctx() in trace_moola.c
 
 //  These macros and in-line functions improve code readability by abstracting these common actions
-#define FIND_WS 	while (c != ' ' && c != '\t' && c != '\n') { c = *cptr++; }
-#define SKIP_WS 	while (c == ' ' || c == '\t') { c = *cptr++; }
+#define FIND_WS 	while (pc->c != ' ' && pc->c != '\t' && pc->c != '\n') { pc->c = *pc->cptr++; }
+#define SKIP_WS 	while (pc->c == ' ' || pc->c == '\t') { pc->c = *pc->cptr++; }
 
-void inline glget_dec(void);		//  get decimal value from input trace line
-void inline glget_hex(void);		//  get hexadecimal value from input trace line
-void inline glget_hexbytes(void);	//  get hexadecimal value from input trace line as sequence of bytes
-char *process_nodata(memref *mr);	//  process trace record
+void inline glget_dec(parse_ctx *pc);		//  get decimal value from input trace line
+void inline glget_hex(parse_ctx *pc);		//  get hexadecimal value from input trace line
+void inline glget_hexbytes(parse_ctx *pc);	//  get hexadecimal value from input trace line as sequence of bytes
+char *process_nodata(parse_ctx *pc, memref *mr);	//  process trace record
 
 
 //  These lookup tables allow fast identification of character types and values
@@ -162,8 +150,11 @@ static char isdec[256] = { 0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,
 //	'fndx' is the index into the global gzipped-file list of the file to close
 //	The entry in the list of file pointers is set to NULL
 void trace_close_gleipnir_gz(int16_t fndx) {
-	gzclose(gzfil[fndx]);
-	gzfil[fndx] = NULL;
+	parse_ctx	*pc;			//	parser context of this file
+	
+	pc = parse_ctxs[fndx];
+	gzclose(pc->gzfil);
+	pc->gzfil = NULL;
 	return;
 }
 
@@ -173,8 +164,11 @@ void trace_close_gleipnir_gz(int16_t fndx) {
 //	'fndx' is the index into the global text-file list of the file to close
 //	The entry in the list of file pointers is set to NULL
 void trace_close_gleipnir_txt(int16_t fndx) {
-	close(txtfil[fndx]);
-	txtfil[fndx] = NULL;
+	parse_ctx	*pc;			//	parser context of this file
+	
+	pc = parse_ctxs[fndx];
+	close(pc->txtfil);
+	pc->txtfil = NULL;
 	return;
 }
 
@@ -185,13 +179,18 @@ void trace_close_gleipnir_txt(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_open_gleipnir_gz(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	gzfil[fndx] = gzopen(in_fnames[fndx], "r");
-	if (gzfil[fndx] == NULL) {
+	pc = get_parse_ctx(fndx);
+	if (pc == NULL) {
+		return 0;
+	}
+	pc->gzfil = gzopen(in_fnames[fndx], "r");
+	if (pc->gzfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
-		in_lineno[fndx] = 0;
+		pc->lineno = 0;
 		return 1;
 	}
 	
@@ -203,13 +202,18 @@ int32_t trace_open_gleipnir_gz(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_open_gleipnir_txt(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	txtfil[fndx] = fopen(in_fnames[fndx], "r");
-	if (txtfil[fndx] == NULL) {
+	pc = get_parse_ctx(fndx);
+	if (pc == NULL) {
+		return 0;
+	}
+	pc->txtfil = fopen(in_fnames[fndx], "r");
+	if (pc->txtfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
-		in_lineno[fndx] = 0;
+		pc->lineno = 0;
 		return 1;
 	}
 	
@@ -222,9 +226,11 @@ int32_t trace_open_gleipnir_txt(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_reopen_gleipnir_gz(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	gzfil[fndx] = gzopen(in_fnames[fndx], "r");
-	if (gzfil[fndx] == NULL) {
+	pc = parse_ctxs[fndx];
+	pc->gzfil = gzopen(in_fnames[fndx], "r");
+	if (pc->gzfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
@@ -239,9 +245,11 @@ int32_t trace_reopen_gleipnir_gz(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_reopen_gleipnir_txt(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	txtfil[fndx] = fopen(in_fnames[fndx], "r");
-	if (txtfil[fndx] == NULL) {
+	pc = parse_ctxs[fndx];
+	pc->txtfil = fopen(in_fnames[fndx], "r");
+	if (pc->txtfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
@@ -262,17 +270,18 @@ int32_t trace_reopen_gleipnir_txt(int16_t fndx) {
 int32_t trace_read_gleipnir_gz(int16_t fndx, memref *mr) {
 	//	see list of static/global variables as well as these local variables
 	char		*stat;				//	status response for gzgets and process_values
-	crntfndx = fndx;				//	set for error messages to use
+	parse_ctx	*pc;				//	parser context of this file
+	pc = parse_ctxs[fndx];
 	while (1) {						//	loop until valid record or end-of-file
-		stat = gzgets(gzfil[fndx], ibfr, 160);		//	get next line of input from gzip input file
+		stat = gzgets(pc->gzfil, pc->ibfr, 160);		//	get next line of input from gzip input file
 		if (stat == NULL) {
 			//	end of file reached
 			return 0;
 		}
-		in_lineno[fndx]++;			//	increment line number
-		stat = process_nodata(mr);
+		pc->lineno++;			//	increment line number
+		stat = process_nodata(pc, mr);
 		if (stat) {					//	stat != 0 => valid input, otherwise get new line
-			mr->linenmbr = in_lineno[fndx];
+			mr->linenmbr = pc->lineno;
 			return 1;
 		}
 	}
@@ -290,17 +299,18 @@ int32_t trace_read_gleipnir_gz(int16_t fndx, memref *mr) {
 int32_t trace_read_gleipnir_txt(int16_t fndx, memref *mr) {
 	//	see list of static/global variables as well as these local variables
 	char		*stat;				//	status response for fgets and process_values
-	crntfndx = fndx;				//	set for error messages to use
+	parse_ctx	*pc;				//	parser context of this file
+	pc = parse_ctxs[fndx];
 	while (1) {						//	loop until valid record or end-of-file
-		stat = fgets(ibfr, 600, txtfil[fndx]);		//	get next line of input from text input file
+		stat = fgets(pc->ibfr, 600, pc->txtfil);		//	get next line of input from text input file
 		if (stat == NULL) {
 			//	end of file reached
 			return 0;
 		}
-		in_lineno[fndx]++;			//	increment line number
-		stat = process_nodata(mr);
+		pc->lineno++;			//	increment line number
+		stat = process_nodata(pc, mr);
 		if (stat) {					//	stat != 0 => valid input, otherwise get new line
-			mr->linenmbr = in_lineno[fndx];
+			mr->linenmbr = pc->lineno;
 			return 1;
 		}
 	}
@@ -308,19 +318,20 @@ int32_t trace_read_gleipnir_txt(int16_t fndx, memref *mr) {
 
 
 
-char *process_nodata(memref *mr) {
-	int16_t	i;					//	index for copying function and variable names
+char *process_nodata(parse_ctx *pc, memref *mr) {
+	int16_t	i;					//	length of the function and variable names
+	char	*name;				//	first character of the function or variable name
 	
-	mr->fname[0] = '\0';		//	some initializations
+	mr->fname_id = SYM_NONE;	//	some initializations
 	mr->scope[0] = '\0';
-	mr->vname[0] = '\0';
+	mr->vname_id = SYM_NONE;
 	
-	cptr = ibfr;				//	set to first character in trace record
-	c = *cptr++;				//	get 1st char and point to next character
+	pc->cptr = pc->ibfr;				//	set to first character in trace record
+	pc->c = *pc->cptr++;				//	get 1st char and point to next character
 	SKIP_WS						//	white space allowed at start of line (not expected though)
 	
 	//	get the trace record type code
-	switch (c) {
+	switch (pc->c) {
 		case 'A':
 		case 'a':	mr->oper = XALLOC; break;
 		case 'F':
@@ -343,41 +354,41 @@ char *process_nodata(memref *mr) {
 		default:
 			fprintf(stderr,
 					"Unexpected trace record type, '%c', at column %ld in file %s line %lld\n%s",
-					c, cptr - ibfr, in_fnames[crntfndx], in_lineno[crntfndx], ibfr);
+					pc->c, pc->cptr - pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->ibfr);
 			return NULL;
 	}
 	
-	c = *cptr++;				//	"consume" this character and go to next
-	if (c == 'T') {
+	pc->c = *pc->cptr++;				//	"consume" this character and go to next
+	if (pc->c == 'T') {
 		return NULL;			//	skip the "START PID" record
 	}
-	if (c != ' '  &&  c != '\t') {
+	if (pc->c != ' '  &&  pc->c != '\t') {
 		fprintf(stderr, "Space required after record type at column %ld in file %s, line %lld\n%s",
-				cptr - ibfr, in_fnames[crntfndx], in_lineno[crntfndx], ibfr);
+				pc->cptr - pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->ibfr);
 		return NULL;			//	require white space after record type code
 	}
 	
 	
 	
 	//  next field is virtual address in hex
-	glget_hex();
-	if (!cptr)	return NULL;	//	skip line if error in glget_hex
-	mr->virt_adrs = val;		//	save value as the virtual address
+	glget_hex(pc);
+	if (!pc->cptr)	return NULL;	//	skip line if error in glget_hex
+	mr->virt_adrs = pc->val;		//	save value as the virtual address
 	
 	//  next field is physical address in hex
-	glget_hex();
-	if (!cptr)	return NULL;	//	skip line if error in glget_hex
-	mr->adrs = val;				//	save value as the physical address
+	glget_hex(pc);
+	if (!pc->cptr)	return NULL;	//	skip line if error in glget_hex
+	mr->adrs = pc->val;				//	save value as the physical address
 	
 	//	next field is transaction size in decimal
-	glget_dec();
-	if (!cptr)	return NULL;	//	skip line if error in glget_dec
-	mr->size = (int32_t) val;	//  save value as the size
+	glget_dec(pc);
+	if (!pc->cptr)	return NULL;	//	skip line if error in glget_dec
+	mr->size = (int32_t) pc->val;	//  save value as the size
 	
 	//	next field is thread ID in decimal
-	glget_dec();
-	if (!cptr)	return NULL;	//	skip line if error in glget_dec
-	mr->pid = (int8_t) (val % nmbr_cores);		//	save TID % #cores as the processor ID
+	glget_dec(pc);
+	if (!pc->cptr)	return NULL;	//	skip line if error in glget_dec
+	mr->pid = (int8_t) (pc->val % nmbr_cores);		//	save TID % #cores as the processor ID
 	
 	//	next field is single character indicating Global, Heap, Stack, or 'other'
 	SKIP_WS						//	get character code of memory segment and make it 0-4
@@ -386,88 +397,90 @@ char *process_nodata(memref *mr) {
 	if (mr->oper == MRINSTR) {
 		mr->segmnt = INSTR;		//	instruction records have no segment at this time
 	} else {
-		if (c == 'H' || c == 'h') {
+		if (pc->c == 'H' || pc->c == 'h') {
 			mr->segmnt = HEAP;
-		} else if (c == 'S' || c == 's') {
+		} else if (pc->c == 'S' || pc->c == 's') {
 			mr->segmnt = STACK;
-		} else if (c == 'G' || c == 'g') {
+		} else if (pc->c == 'G' || pc->c == 'g') {
 			mr->segmnt = GLOBAL;
 		} else {
 			mr->segmnt = OTHER;
 		}
-		c = *cptr++;				//	"consume" this character and go to next
+		pc->c = *pc->cptr++;				//	"consume" this character and go to next
 	}
 	
 	//  set up default function/variable/scope values for early EOL return
-	strcpy(mr->fname, "_unknown_");
+	mr->fname_id = SYM_UNKNOWN;
 	mr->scope[0] = 'N';
 	mr->scope[1] = 'A';
 	mr->scope[2] = '\0';
 	mr->h_enum = 0;
 	switch(mr->segmnt){
 		case GLOBAL:
-			strcpy(mr->vname, "_global_");
+			mr->vname_id = SYM_GLOBAL;
 			break;
 		case HEAP:
-			strcpy(mr->vname, "_heap_");
+			mr->vname_id = SYM_HEAP;
 			break;
 		case INSTR:
-			strcpy(mr->vname, "_instruction_");
+			mr->vname_id = SYM_INSTR;
 			break;
 		case STACK:
-			strcpy(mr->vname, "_stack_");
+			mr->vname_id = SYM_STACK;
 			break;
 		default:
-			strcpy(mr->vname, "_unknown_");
+			mr->vname_id = SYM_UNKNOWN;
 	}
 	
 	//  next field should be function name
 	SKIP_WS
-	if (c == '\n') {
+	if (pc->c == '\n') {
 		//  hit end of line, so return the available information
 		return 1;				//	return as valid trace record
 	}
 	
-	//	copy function name
+	//	intern function name
+	name = pc->cptr - 1;
 	i = 0;
-	while (c != '\n'  &&  c != ' '  &&  c != '\t'  &&  i < FSIZE-1) {
-		mr->fname[i++] = c;
-		c = *cptr++;
+	while (pc->c != '\n'  &&  pc->c != ' '  &&  pc->c != '\t'  &&  i < FSIZE-1) {
+		i++;
+		pc->c = *pc->cptr++;
 	}
-	mr->fname[i] = '\0';		//	terminate the string
+	mr->fname_id = intern_symbol(name, i);
 	if (i >= FSIZE-1) {			//	skip remainder of function name
-		while (c != '\n'  &&  c != ' '  &&  c != '\t') c = cptr++;
+		while (pc->c != '\n'  &&  pc->c != ' '  &&  pc->c != '\t') pc->c = *pc->cptr++;
 	}
 	
 	//  next field should be scope
 	SKIP_WS
-	if (c == '\n') {
+	if (pc->c == '\n') {
 		//  hit end of line, so return the available information
 		return 1;				//	return as valid trace record
 	}
-	mr->scope[0] = c;
-	mr->scope[1] = *cptr++;
+	mr->scope[0] = pc->c;
+	mr->scope[1] = *pc->cptr++;
 	
 	if (mr->scope[0] == 'H') {
-		mr->h_enum = (int32_t) strtol(cptr, NULL, 0);
+		mr->h_enum = (int32_t) strtol(pc->cptr, NULL, 0);
 		mr->scope[1] = '\0';	//	overwrite '-'
 	}
-	c = *cptr++;				//	consume 2nd scope char and get next
+	pc->c = *pc->cptr++;				//	consume 2nd scope char and get next
 	
 	//  next field should be variable
 	SKIP_WS
-	if (c == '\n') {
+	if (pc->c == '\n') {
 		//  hit end of line, so return the available information
 		return 1;				//	return as valid trace record
 	}
 	
-	//  copy first component of variable name
+	//  intern first component of variable name
+	name = pc->cptr - 1;
 	i = 0;
-	while (c != '\n'  &&  c != ' '  &&  c != '\t'  &&  c != '['  && c != '.'  &&  i < VSIZE-1) {
-		mr->vname[i++] = c;
-		c = *cptr++;
+	while (pc->c != '\n'  &&  pc->c != ' '  &&  pc->c != '\t'  &&  pc->c != '['  && pc->c != '.'  &&  i < VSIZE-1) {
+		i++;
+		pc->c = *pc->cptr++;
 	}
-	mr->vname[i] = '\0';		//	terminate the string
+	mr->vname_id = intern_symbol(name, i);
 	return 1;					//	return as valid trace record, skipping remainder (if any) of line
 }
 
@@ -476,18 +489,15 @@ char *process_nodata(memref *mr) {
 
 //  Various support functions used in the process_nodata function:
 
-void glget_dec(void) {		//  get decimal value from input trace line
+void glget_dec(parse_ctx *pc) {		//  get decimal value from input trace line
 	SKIP_WS
-	val = 0;
-	if (!isdec[c]) {
+	pc->val = 0;
+	if (!isdec[pc->c]) {
 		fprintf(stderr, "ERROR:  expecting decimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-				cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-		cptr = NULL;		//  flag error
+				pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+		pc->cptr = NULL;		//  flag error
 	} else {
-		while (isdec[c]) {		//	first non-decimal character terminates the value
-			val = val * 10 + char_val[c];
-			c = *cptr++;
-		}
+		scan_dec(pc);				//	first non-decimal character terminates the value
 	}
 	return;
 }
@@ -495,44 +505,47 @@ void glget_dec(void) {		//  get decimal value from input trace line
 
 
 
-void glget_hex(void) {		//  get hexadecimal value from input trace line
+void glget_hex(parse_ctx *pc) {		//  get hexadecimal value from input trace line
 	SKIP_WS
-	val = 0;
-	if (!ishex[c]) {
+	pc->val = 0;
+	if (!ishex[pc->c]) {
 		fprintf(stderr, "ERROR:  expecting hexadecimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-				cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-		cptr = NULL;		//  flag error
+				pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+		pc->cptr = NULL;		//  flag error
 	} else {
-		while (ishex[c]) {		//	first non-hex character terminates the value
-			val = val * 16 + char_val[c];
-			c = *cptr++;
-		}
+		scan_hex(pc);				//	first non-hex character terminates the value
 	}
 	return;
 }
 
 
-void glget_hexbytes(void) {	//  get hexadecimal value from input trace line as sequence of bytes
+void glget_hexbytes(parse_ctx *pc) {	//  get hexadecimal value from input trace line as sequence of bytes
 									//  val contains the just read size
-	for (bndx = 0; bndx < val; bndx++) {
-		bytes[bndx] = 0;
+	if (pc->val > 0) {
+		SKIP_WS
+		if (scan_hexbytes(pc)) {
+			return;					//	all of the bytes were converted at once
+		}
+	}
+	for (pc->bndx = 0; pc->bndx < pc->val; pc->bndx++) {
+		pc->bytes[pc->bndx] = 0;
 		SKIP_WS
-		if (!ishex[c]) {
+		if (!ishex[pc->c]) {
 			fprintf(stderr, "ERROR:  expecting hexadecimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-					cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-			cptr = NULL;		//  flag error
+					pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+			pc->cptr = NULL;		//  flag error
 			break;
 		} else {
-			bytes[bndx] = char_val[c];
-			c = *cptr++;
-			if (!ishex[c]) {
+			pc->bytes[pc->bndx] = char_val[pc->c];
+			pc->c = *pc->cptr++;
+			if (!ishex[pc->c]) {
 				fprintf(stderr, "ERROR:  expecting hexadecimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-						cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-				cptr = NULL;		//  flag error
+						pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+				pc->cptr = NULL;		//  flag error
 				break;
 			} else {
-				bytes[bndx] = bytes[bndx] * 16 + char_val[c];
-				c = *cptr++;
+				pc->bytes[pc->bndx] = pc->bytes[pc->bndx] * 16 + char_val[pc->c];
+				pc->c = *pc->cptr++;
 			}
 		}
 	}
@@ -0,0 +1,614 @@
+//
+//  trace_moola_bin.c  (trace file input for binary moola format for Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "moola.h"
+
+
+//	"trace_moola_bin.c" incorporates the trace file access functions for the two binary moola
+//	formats and the functions to write them.  Both formats are read from a memory-mapped
+//	file with no per-record system calls and no text parsing.
+//
+//	moola_bin is a fixed-width image of the memref fields that the text readers decode.
+//	The file is an mbin_hdr record followed by 'nmbr_recs' mbin_rec records, both defined
+//	in moola.h.  The header carries a magic string, a format version and the size of an
+//	mbin_rec so that files written by a different compilation are rejected at open.
+//	Data values are always present in the file; they are only copied to the memref when
+//	Moola is compiled with DATAVALS.
+//
+//	moola_blk is the compact format written by the moola_conv converter.  Records are
+//	grouped in blocks of 'blk_recs' records and an index of mblk_ndx entries (block start
+//	line number, per-processor instruction counts and file offset) follows the last block.
+//	Each record is encoded as:
+//		tag			oper in bits 0-3, segment in bits 4-6, bit 7 set when pid/asid follow
+//		pid asid	one byte each, only when the processor or the asid differs from the
+//					previous record
+//		address		zigzag varint of the difference from the previous address of this processor
+//		line		zigzag varint of (line number - previous line number - 1)
+//		size		varint
+//		data		min(size, MAX_MR_DATA) bytes for data and instruction accesses when
+//					the header has_data flag is set
+//	The previous processor, addresses and line number are reset at the start of each block.
+//	The reader checks that each block starts at the file offset of its index entry and that
+//	its first record has the line number of the entry, so a damaged file is reported as
+//	corrupt instead of being decoded from the wrong position.
+//
+//	For both formats the line number of the originating text record is kept in each binary
+//	record so error and debug messages still refer to the source trace.
+
+
+//	The state of each open binary trace file is maintained between calls in a bin_fil entry,
+//	the table of entries is allocated when the first file is opened
+typedef struct bin_fil_rec {
+	uint8_t		*base;		//	base of the memory mapping of the file
+	size_t		len;		//	length of the memory mapping of the file
+	int64_t		ndx;		//	index of the next record to read from the file
+	int64_t		nrecs;		//	number of records in the file
+	mbin_rec	*recs;		//	first record of a moola_bin file (just after the header)
+	int32_t		blk_recs;	//	records per block of a moola_blk file
+	int16_t		blk_data;	//	has_data flag of a moola_blk file
+	uint8_t		*blk_end;	//	end of the block data (start of index) of a moola_blk file
+	uint8_t		*blk_pos;	//	next byte to decode in a moola_blk file
+	mblk_ndx	*blk_ndx;	//	block index of a moola_blk file
+	int64_t		blk_line;	//	line number the first record of the current block must have
+	int64_t		prev_adrs[MAX_PIDS];	//	previous address of each processor
+	int64_t		prev_line;	//	previous line number
+	int8_t		prev_asid;	//	previous asid
+	int8_t		prev_pid;	//	previous processor, -1 => none
+} bin_fil;
+
+static bin_fil		*bins;					//	state of each input file, 'in_filcnt' entries
+
+
+//  These macros convert signed differences to and from the zigzag form used in the varints
+#define ZIGZAG(x)	(((uint64_t) (x) << 1) ^ (uint64_t) ((int64_t) (x) >> 63))
+#define UNZIGZAG(x)	((int64_t) ((x) >> 1) ^ -(int64_t) ((x) & 1))
+
+
+
+//	bin_map		map a binary trace file and check its magic string
+//	'fndx' is the index of the file, 'fnam' is the name of the file to map
+//	'magic' is the 8 character magic string expected at the start of the file
+//	'hdr_siz' is the size of the header expected at the start of the file
+//	returns 0 for error, 1 for success
+static int32_t bin_map(int16_t fndx, char *fnam, char *magic, size_t hdr_siz) {
+	int			fd;					//	file descriptor for the trace file
+	struct stat	st;					//	file status to get the file size
+
+	if (bins == NULL) {
+		bins = calloc(in_filcnt, sizeof(bin_fil));
+		if (bins == NULL) {
+			printf("Unable to allocate memory for binary trace file state.\n");
+			return 0;
+		}
+	}
+	fd = open(fnam, O_RDONLY);
+	if (fd < 0) {
+		printf("Error opening file '%s' for trace input.\n", fnam);
+		return 0;
+	}
+	if (fstat(fd, &st) != 0  ||  st.st_size < (off_t) hdr_siz) {
+		printf("Error: binary trace file '%s' is too short to contain a header.\n", fnam);
+		close(fd);
+		return 0;
+	}
+	bins[fndx].len = (size_t) st.st_size;
+	bins[fndx].base = mmap(NULL, bins[fndx].len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);						//	the mapping remains valid after the descriptor is closed
+	if (bins[fndx].base == MAP_FAILED) {
+		printf("Error mapping file '%s' for trace input.\n", fnam);
+		bins[fndx].base = NULL;
+		return 0;
+	}
+	madvise(bins[fndx].base, bins[fndx].len, MADV_SEQUENTIAL);
+
+	if (memcmp(bins[fndx].base, magic, 8) != 0) {
+		printf("Error: '%s' is not a %.8s trace file.\n", fnam, magic);
+		munmap(bins[fndx].base, bins[fndx].len);
+		bins[fndx].base = NULL;
+		return 0;
+	}
+	bins[fndx].ndx = 0;
+	return 1;
+}
+
+
+
+//	bin_open	map a moola_bin trace file and validate its header
+//	'fndx' is the index into the global 'in_fnames' of file names
+//	returns 0 for error, 1 for success
+static int32_t bin_open(int16_t fndx) {
+	mbin_hdr	*hdr;				//	header at the start of the mapped file
+
+	if (bin_map(fndx, in_fnames[fndx], MBIN_MAGIC, sizeof(mbin_hdr)) == 0) {
+		return 0;
+	}
+	hdr = (mbin_hdr *) bins[fndx].base;
+	if (hdr->version != MBIN_VERSION  ||  hdr->rec_size != (int32_t) sizeof(mbin_rec)) {
+		printf("Error: '%s' is not a version %d moola_bin trace file.\n", in_fnames[fndx], MBIN_VERSION);
+		trace_close_moola_bin(fndx);
+		return 0;
+	}
+	if (hdr->nmbr_recs < 0  ||
+			(size_t) hdr->nmbr_recs > (bins[fndx].len - sizeof(mbin_hdr)) / sizeof(mbin_rec)) {
+		printf("Error: binary trace file '%s' is truncated.\n", in_fnames[fndx]);
+		trace_close_moola_bin(fndx);
+		return 0;
+	}
+	bins[fndx].recs = (mbin_rec *) (bins[fndx].base + sizeof(mbin_hdr));
+	bins[fndx].nrecs = hdr->nmbr_recs;
+	return 1;
+}
+
+
+
+//	blk_open	map a moola_blk trace file and validate its header
+//	'fndx' is the index of the file, 'fnam' is the name of the file to map
+//	returns 0 for error, 1 for success
+static int32_t blk_open(int16_t fndx, char *fnam) {
+	mblk_hdr	*hdr;				//	header at the start of the mapped file
+
+	if (bin_map(fndx, fnam, MBLK_MAGIC, sizeof(mblk_hdr)) == 0) {
+		return 0;
+	}
+	hdr = (mblk_hdr *) bins[fndx].base;
+	if (hdr->version != MBLK_VERSION  ||  hdr->blk_recs <= 0  ||  hdr->nmbr_recs < 0
+			||  hdr->ndx_offset < (int64_t) sizeof(mblk_hdr)  ||  hdr->ndx_offset > (int64_t) bins[fndx].len
+			||  hdr->nmbr_blks != (hdr->nmbr_recs + hdr->blk_recs - 1) / hdr->blk_recs
+			||  hdr->nmbr_blks > (int64_t) ((bins[fndx].len - hdr->ndx_offset) / sizeof(mblk_ndx))) {
+		printf("Error: '%s' is not a valid version %d moola_blk trace file.\n", fnam, MBLK_VERSION);
+		trace_close_moola_blk(fndx);
+		return 0;
+	}
+	bins[fndx].nrecs = hdr->nmbr_recs;
+	bins[fndx].blk_recs = hdr->blk_recs;
+	bins[fndx].blk_data = hdr->has_data;
+	bins[fndx].blk_pos = bins[fndx].base + sizeof(mblk_hdr);
+	bins[fndx].blk_end = bins[fndx].base + hdr->ndx_offset;
+	bins[fndx].blk_ndx = (mblk_ndx *) (bins[fndx].base + hdr->ndx_offset);
+	return 1;
+}
+
+
+
+//	get_varint		decode an unsigned varint from a moola_blk file
+//	'fndx' is the index of the file, bins[fndx].blk_pos is advanced past the varint
+//	'val' receives the decoded value
+//	returns 0 if the varint runs past the end of the block data, 1 for success
+static inline int32_t get_varint(int16_t fndx, uint64_t *val) {
+	uint8_t		*pos;				//	next byte to decode
+	uint64_t	v;					//	value being accumulated
+	int16_t		shift;				//	bit position of the next 7 bits
+
+	pos = bins[fndx].blk_pos;
+	v = 0;
+	for (shift = 0; shift < 64; shift += 7) {
+		if (pos >= bins[fndx].blk_end) {
+			return 0;
+		}
+		v |= (uint64_t) (*pos & 0x7f) << shift;
+		if ((*pos++ & 0x80) == 0) {
+			bins[fndx].blk_pos = pos;
+			*val = v;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+
+//	put_varint		encode an unsigned varint into 'buf'
+//	returns the number of bytes used (at most 10)
+static inline int16_t put_varint(uint8_t *buf, uint64_t val) {
+	int16_t		n;					//	number of bytes used
+
+	n = 0;
+	while (val >= 0x80) {
+		buf[n++] = (uint8_t) (val | 0x80);
+		val >>= 7;
+	}
+	buf[n++] = (uint8_t) val;
+	return n;
+}
+
+
+
+//  function to close the moola_bin trace file
+//	'fndx' is the index into the global file list for the file to close
+//	The memory mapping for the file is released
+void trace_close_moola_bin(int16_t fndx) {
+	if (bins[fndx].base != NULL) {
+		munmap(bins[fndx].base, bins[fndx].len);
+	}
+	bins[fndx].base = NULL;
+	bins[fndx].recs = NULL;
+	bins[fndx].nrecs = 0;
+	bins[fndx].ndx = 0;
+	return;
+}
+
+
+
+//  function to close the moola_blk trace file
+//	'fndx' is the index into the global file list for the file to close
+//	The memory mapping for the file is released
+void trace_close_moola_blk(int16_t fndx) {
+	trace_close_moola_bin(fndx);
+	bins[fndx].blk_pos = NULL;
+	bins[fndx].blk_end = NULL;
+	bins[fndx].blk_ndx = NULL;
+	return;
+}
+
+
+
+//  function to open the moola_bin trace file
+//	'fndx' is the index into the global 'in_fnames' of file names
+//	returns 0 for error, 1 for success
+int32_t trace_open_moola_bin(int16_t fndx) {
+	return bin_open(fndx);
+}
+
+
+
+//  function to open the moola_blk trace file
+//	'fndx' is the index into the global 'in_fnames' of file names
+//	returns 0 for error, 1 for success
+int32_t trace_open_moola_blk(int16_t fndx) {
+	return blk_open(fndx, in_fnames[fndx]);
+}
+
+
+
+//  function to open a moola_blk trace file for input file 'fndx' under another file name
+//	used by trace_cache.c to read a cached sidecar in place of the source trace file
+//	returns 0 for error, 1 for success
+int32_t trace_open_moola_blk_file(int16_t fndx, char *fnam) {
+	return blk_open(fndx, fnam);
+}
+
+
+
+//  function to return the header has_data flag of the open moola_blk trace file 'fndx'
+//	used by moola_conv so that converting a moola_blk file keeps its data values by default
+int16_t trace_data_moola_blk(int16_t fndx) {
+	return bins[fndx].blk_data;
+}
+
+
+
+//  function to reopen the moola_bin trace file
+//	the line numbers are carried in the records, so reopen is the same as open
+//	'fndx' is the index into the global 'in_fnames' of file names
+//	returns 0 for error, 1 for success
+int32_t trace_reopen_moola_bin(int16_t fndx) {
+	return bin_open(fndx);
+}
+
+
+
+//  function to reopen the moola_blk trace file
+//	the line numbers are carried in the records, so reopen is the same as open
+//	'fndx' is the index into the global 'in_fnames' of file names
+//	returns 0 for error, 1 for success
+int32_t trace_reopen_moola_blk(int16_t fndx) {
+	return blk_open(fndx, in_fnames[fndx]);
+}
+
+
+
+//  The trace_read_moola_bin function copies the next record of the moola_bin trace file into
+//	the *mr record that was provided as an input.
+//  0 is returned if the end of file was reached, 1 is returned for a valid record
+
+int32_t trace_read_moola_bin(int16_t fndx, memref *mr) {
+	mbin_rec	*rec;				//	next record in the mapped file
+
+	if (bins[fndx].ndx >= bins[fndx].nrecs) {
+		return 0;					//	end of file reached
+	}
+	rec = &bins[fndx].recs[bins[fndx].ndx++];
+	mr->adrs = rec->adrs;
+	mr->linenmbr = rec->linenmbr;
+	mr->size = rec->size;
+	mr->oper = rec->oper;
+	mr->segmnt = rec->segmnt;
+	mr->pid = rec->pid;
+	mr->asid = rec->asid;
+#ifdef DATAVALS
+	memcpy(mr->data, rec->data, MAX_MR_DATA);
+#endif
+	return 1;
+}
+
+
+
+//  The trace_read_moola_blk function decodes the next record of the moola_blk trace file into
+//	the *mr record that was provided as an input.
+//  0 is returned if the end of file was reached or the file is corrupt, 1 is returned for a
+//	valid record
+
+int32_t trace_read_moola_blk(int16_t fndx, memref *mr) {
+	mblk_ndx	*bndx;				//	index entry of the block being started
+	uint8_t		tag;				//	tag byte of the record
+	uint64_t	val;				//	decoded varint
+	int16_t		n;					//	number of data bytes in the record
+	int16_t		p;					//	processor index
+
+	if (bins[fndx].ndx >= bins[fndx].nrecs) {
+		return 0;					//	end of file reached
+	}
+	bins[fndx].blk_line = -1;
+	if (bins[fndx].ndx % bins[fndx].blk_recs == 0) {
+		//	start of a block, check it against its index entry and reset the delta encoding state
+		bndx = &bins[fndx].blk_ndx[bins[fndx].ndx / bins[fndx].blk_recs];
+		if (bins[fndx].blk_pos != bins[fndx].base + bndx->offset) {
+			goto r_corrupt;
+		}
+		bins[fndx].blk_line = bndx->linenmbr;
+		bins[fndx].prev_line = 0;
+		bins[fndx].prev_pid = -1;
+		bins[fndx].prev_asid = 0;
+		for (p = 0; p < MAX_PIDS; p++) {
+			bins[fndx].prev_adrs[p] = 0;
+		}
+	}
+	if (bins[fndx].blk_pos >= bins[fndx].blk_end) {
+		goto r_corrupt;
+	}
+	tag = *bins[fndx].blk_pos++;
+	if (tag & 0x80) {
+		if (bins[fndx].blk_pos + 2 > bins[fndx].blk_end  ||  bins[fndx].blk_pos[0] >= MAX_PIDS) {
+			goto r_corrupt;
+		}
+		bins[fndx].prev_pid = bins[fndx].blk_pos[0];
+		bins[fndx].prev_asid = bins[fndx].blk_pos[1];
+		bins[fndx].blk_pos += 2;
+	} else if (bins[fndx].prev_pid < 0) {
+		goto r_corrupt;
+	}
+	p = bins[fndx].prev_pid;
+	mr->oper = tag & 0x0f;
+	mr->segmnt = (tag >> 4) & 0x07;
+	mr->pid = p;
+	mr->asid = bins[fndx].prev_asid;
+	
+	if (!get_varint(fndx, &val))	goto r_corrupt;
+	bins[fndx].prev_adrs[p] += UNZIGZAG(val);
+	mr->adrs = bins[fndx].prev_adrs[p];
+	
+	if (!get_varint(fndx, &val))	goto r_corrupt;
+	bins[fndx].prev_line += UNZIGZAG(val) + 1;
+	mr->linenmbr = bins[fndx].prev_line;
+	if (bins[fndx].blk_line >= 0  &&  mr->linenmbr != bins[fndx].blk_line) {
+		goto r_corrupt;
+	}
+	
+	if (!get_varint(fndx, &val))	goto r_corrupt;
+	mr->size = (int32_t) val;
+	
+	if (bins[fndx].blk_data  &&  mr->oper < XALLOC  &&  mr->size > 0) {
+		n = mr->size < MAX_MR_DATA ? mr->size : MAX_MR_DATA;
+		if (bins[fndx].blk_pos + n > bins[fndx].blk_end) {
+			goto r_corrupt;
+		}
+#ifdef DATAVALS
+		memcpy(mr->data, bins[fndx].blk_pos, n);
+#endif
+		bins[fndx].blk_pos += n;
+	}
+	bins[fndx].ndx++;
+	return 1;
+	
+r_corrupt:
+	fprintf(stderr, "ERROR:  corrupt record %lld in moola_blk trace file %s\n",
+			(long long) bins[fndx].ndx, in_fnames[fndx]);
+	bins[fndx].ndx = bins[fndx].nrecs;	//	treat the rest of the file as end of file
+	return 0;
+}
+
+
+
+//  function to create a moola_bin (blocked = 0) or moola_blk (blocked = 1) trace file
+//	'wr' is the writer state to initialize, 'fname' is the name of the file to create
+//	'has_data' selects writing data values in moola_blk files (moola_bin always has them)
+//	A place holder header is written; it is completed by trace_finish_moola_bin
+//	returns 0 for error, 1 for success
+int32_t trace_create_moola_bin(mbin_wrtr *wr, char *fname, int16_t blocked, int16_t has_data) {
+	mblk_hdr	hdr;				//	place holder header, the larger of the two headers
+	size_t		hdr_siz;			//	size of the header for the selected format
+	int16_t		p;					//	processor index
+
+	memset(wr, 0, sizeof(mbin_wrtr));
+	wr->fil = fopen(fname, "wb");
+	if (wr->fil == NULL) {
+		printf("ERROR:  could not open '%s' for writing\n", fname);
+		return 0;
+	}
+	setvbuf(wr->fil, NULL, _IOFBF, 1 << 20);
+	wr->blocked = blocked;
+	wr->has_data = has_data;
+	wr->prev_pid = -1;
+	for (p = 0; p < MAX_PIDS; p++) {
+		wr->prev_adrs[p] = 0;
+		wr->time[p] = 0;
+	}
+	hdr_siz = blocked ? sizeof(mblk_hdr) : sizeof(mbin_hdr);
+	memset(&hdr, 0, sizeof(hdr));
+	if (fwrite(&hdr, hdr_siz, 1, wr->fil) != 1) {
+		printf("ERROR:  could not write header to '%s'\n", fname);
+		fclose(wr->fil);
+		wr->fil = NULL;
+		return 0;
+	}
+	wr->offset = hdr_siz;
+	return 1;
+}
+
+
+
+//  function to append the memory reference *mr to a trace file opened by trace_create_moola_bin
+//	returns 0 for error, 1 for success
+int32_t trace_write_moola_bin(mbin_wrtr *wr, memref *mr) {
+	mbin_rec	rec;				//	fixed-width record for moola_bin
+	uint8_t		buf[3 + 3 * 10 + MAX_MR_DATA];	//	encoded record for moola_blk
+	int16_t		len;				//	number of bytes used in buf
+	int16_t		n;					//	number of data bytes
+	int16_t		p;					//	processor index
+	mblk_ndx	*ndx;				//	new block index entry
+
+	if (!wr->blocked) {
+		memset(&rec, 0, sizeof(rec));
+		rec.adrs = mr->adrs;
+		rec.linenmbr = mr->linenmbr;
+		rec.size = mr->size;
+		rec.oper = mr->oper;
+		rec.segmnt = mr->segmnt;
+		rec.pid = mr->pid;
+		rec.asid = mr->asid;
+#ifdef DATAVALS
+		memcpy(rec.data, mr->data, MAX_MR_DATA);
+#endif
+		if (fwrite(&rec, sizeof(rec), 1, wr->fil) != 1) {
+			return 0;
+		}
+		wr->offset += sizeof(rec);
+		wr->nmbr_recs++;
+		return 1;
+	}
+	
+	if (mr->pid < 0  ||  mr->pid >= MAX_PIDS) {
+		printf("ERROR:  processor ID %d at line %lld cannot be written to a moola_blk file\n",
+			   mr->pid, (long long) mr->linenmbr);
+		return 0;
+	}
+	if (wr->nmbr_recs % MBLK_RECS == 0) {
+		//	start a new block: record its index entry and reset the delta encoding state
+		if (wr->nmbr_blks == wr->ndx_max) {
+			wr->ndx_max = wr->ndx_max ? 2 * wr->ndx_max : 1024;
+			ndx = realloc(wr->ndx, wr->ndx_max * sizeof(mblk_ndx));
+			if (ndx == NULL) {
+				printf("ERROR:  unable to allocate memory for moola_blk block index\n");
+				return 0;
+			}
+			wr->ndx = ndx;
+		}
+		ndx = &wr->ndx[wr->nmbr_blks++];
+		ndx->linenmbr = mr->linenmbr;
+		ndx->offset = wr->offset;
+		for (p = 0; p < MAX_PIDS; p++) {
+			ndx->time[p] = wr->time[p];
+			wr->prev_adrs[p] = 0;
+		}
+		wr->prev_line = 0;
+		wr->prev_pid = -1;
+	}
+	
+	p = mr->pid;
+	len = 0;
+	if (p != wr->prev_pid  ||  mr->asid != wr->prev_asid) {
+		buf[len++] = (mr->oper & 0x0f) | ((mr->segmnt & 0x07) << 4) | 0x80;
+		buf[len++] = (uint8_t) p;
+		buf[len++] = (uint8_t) mr->asid;
+		wr->prev_pid = p;
+		wr->prev_asid = mr->asid;
+	} else {
+		buf[len++] = (mr->oper & 0x0f) | ((mr->segmnt & 0x07) << 4);
+	}
+	len += put_varint(buf + len, ZIGZAG(mr->adrs - wr->prev_adrs[p]));
+	wr->prev_adrs[p] = mr->adrs;
+	len += put_varint(buf + len, ZIGZAG(mr->linenmbr - wr->prev_line - 1));
+	wr->prev_line = mr->linenmbr;
+	len += put_varint(buf + len, (uint32_t) mr->size);
+	if (wr->has_data  &&  mr->oper < XALLOC  &&  mr->size > 0) {
+		n = mr->size < MAX_MR_DATA ? mr->size : MAX_MR_DATA;
+#ifdef DATAVALS
+		memcpy(buf + len, mr->data, n);
+#else
+		memset(buf + len, 0, n);
+#endif
+		len += n;
+	}
+	if (fwrite(buf, len, 1, wr->fil) != 1) {
+		return 0;
+	}
+	wr->offset += len;
+	wr->nmbr_recs++;
+	if (mr->oper == MRINSTR) {
+		wr->time[p]++;				//	per-processor instruction count used as block time
+	}
+	return 1;
+}
+
+
+
+//  function to write the index and the final header and to close a trace file opened by
+//	trace_create_moola_bin
+//	returns 0 for error, 1 for success
+int32_t trace_finish_moola_bin(mbin_wrtr *wr) {
+	mbin_hdr	bhdr;				//	final moola_bin header
+	mblk_hdr	khdr;				//	final moola_blk header
+	int32_t		stat;				//	status of the writes
+
+	stat = 1;
+	if (wr->blocked) {
+		if (wr->nmbr_blks  &&  fwrite(wr->ndx, sizeof(mblk_ndx), wr->nmbr_blks, wr->fil) != (size_t) wr->nmbr_blks) {
+			stat = 0;
+		}
+		memset(&khdr, 0, sizeof(khdr));
+		memcpy(khdr.magic, MBLK_MAGIC, 8);
+		khdr.version = MBLK_VERSION;
+		khdr.blk_recs = MBLK_RECS;
+		khdr.nmbr_recs = wr->nmbr_recs;
+		khdr.nmbr_blks = wr->nmbr_blks;
+		khdr.ndx_offset = wr->offset;
+		khdr.nmbr_pids = MAX_PIDS;
+		khdr.has_data = wr->has_data;
+		if (fseek(wr->fil, 0, SEEK_SET) != 0  ||  fwrite(&khdr, sizeof(khdr), 1, wr->fil) != 1) {
+			stat = 0;
+		}
+	} else {
+		memset(&bhdr, 0, sizeof(bhdr));
+		memcpy(bhdr.magic, MBIN_MAGIC, 8);
+		bhdr.version = MBIN_VERSION;
+		bhdr.rec_size = sizeof(mbin_rec);
+		bhdr.nmbr_recs = wr->nmbr_recs;
+		if (fseek(wr->fil, 0, SEEK_SET) != 0  ||  fwrite(&bhdr, sizeof(bhdr), 1, wr->fil) != 1) {
+			stat = 0;
+		}
+	}
+	if (fclose(wr->fil) != 0) {
+		stat = 0;
+	}
+	wr->fil = NULL;
+	free(wr->ndx);
+	wr->ndx = NULL;
+	return stat;
+}
@@ -70,31 +70,17 @@
 
 
 
-//	The following variables are either static or global to functions in this file
-//  The global data is required for the in-line functions and source macros to operate properly
-//	The static data is required for maintaining state information between calls to the functions
-uint8_t		*bytes;			//	pointer to data value bytes (function global)
-int16_t		bndx;			//	index to the current byte of data (function global)
-char		c;				//  character from input trace file (function global)
-char		c2;				//  second character from input trace file (function global)
-char		*cptr;			//	pointer to next character in ibfr (function global)
-int16_t		crntfndx;		//	current file index for use by sub function error reporting (function global)
-gzFile		*gzfil[8];		//	pointers to gzipped trace files for input (static)
-char		ibfr[160];		//	buffer for input, 160 should be long enough for each line (function global)
-int64_t		in_lineno[8];	//	line number of most recently read line in the files (static)
-int32_t		mapit;			//	from input file, 0 - do not add offset, 1 - add offset to address
-FILE		*txtfil[8];		//	pointers to text trace files for input (static)
-int64_t		val;			//	temporary generation of an input value (function global)
+//	The parser state for each input file is kept in its parse_ctx, see get_parse_ctx() in trace_moola.c
 
 //  These macros and in-line functions improve code readability by abstracting these common actions
-#define FIND_WS 	while (c != ' ' && c != '\t' && c != '\n') { c = *cptr++; }
-#define SKIP_WS 	while (c == ' ' || c == '\t') { c = *cptr++; }
+#define FIND_WS 	while (pc->c != ' ' && pc->c != '\t' && pc->c != '\n') { pc->c = *pc->cptr++; }
+#define SKIP_WS 	while (pc->c == ' ' || pc->c == '\t') { pc->c = *pc->cptr++; }
 
-void inline get_dec_pin(void);		//  get decimal value from input trace line
-void inline get_hex_pin(void);		//  get hexadecimal value from input trace line
-void inline get_hexbytes_pin(void);	//  get hexadecimal value from input trace line as sequence of bytes
-char *process_pin_data(memref *mr);	//  process trace records containing memory data values
-char *process_pin_nodata(memref *mr);	//  process trace records that contain no memory data values
+void inline get_dec_pin(parse_ctx *pc);		//  get decimal value from input trace line
+void inline get_hex_pin(parse_ctx *pc);		//  get hexadecimal value from input trace line
+void inline get_hexbytes_pin(parse_ctx *pc);	//  get hexadecimal value from input trace line as sequence of bytes
+char *process_pin_data(parse_ctx *pc, memref *mr);	//  process trace records containing memory data values
+char *process_pin_nodata(parse_ctx *pc, memref *mr);	//  process trace records that contain no memory data values
 
 
 //  These lookup tables allow fast identification of character types and values
@@ -155,8 +141,11 @@ static char isdec[256] = { 0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,
 //	'fndx' is the index into the global gzipped-file list for the file to close
 //	The entry in the list of file pointers is set to NULL
 void trace_close_pin_gz(int16_t fndx) {
-	gzclose(gzfil[fndx]);
-	gzfil[fndx] = NULL;
+	parse_ctx	*pc;			//	parser context of this file
+	
+	pc = parse_ctxs[fndx];
+	gzclose(pc->gzfil);
+	pc->gzfil = NULL;
 	return;
 }
 
@@ -166,8 +155,11 @@ void trace_close_pin_gz(int16_t fndx) {
 //	'fndx' is the index into the global text-file list for the file to close
 //	The entry in the list of file pointers is set to NULL
 void trace_close_pin_txt(int16_t fndx) {
-	close(txtfil[fndx]);
-	txtfil[fndx] = NULL;
+	parse_ctx	*pc;			//	parser context of this file
+	
+	pc = parse_ctxs[fndx];
+	close(pc->txtfil);
+	pc->txtfil = NULL;
 	return;
 }
 
@@ -178,13 +170,18 @@ void trace_close_pin_txt(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_open_pin_gz(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	gzfil[fndx] = gzopen(in_fnames[fndx], "r");
-	if (gzfil[fndx] == NULL) {
+	pc = get_parse_ctx(fndx);
+	if (pc == NULL) {
+		return 0;
+	}
+	pc->gzfil = gzopen(in_fnames[fndx], "r");
+	if (pc->gzfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
-		in_lineno[fndx] = 0;
+		pc->lineno = 0;
 		return 1;
 	}
 	
@@ -196,13 +193,18 @@ int32_t trace_open_pin_gz(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_open_pin_txt(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	txtfil[fndx] = fopen(in_fnames[fndx], "r");
-	if (txtfil[fndx] == NULL) {
+	pc = get_parse_ctx(fndx);
+	if (pc == NULL) {
+		return 0;
+	}
+	pc->txtfil = fopen(in_fnames[fndx], "r");
+	if (pc->txtfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
-		in_lineno[fndx] = 0;
+		pc->lineno = 0;
 		return 1;
 	}
 	
@@ -215,9 +217,11 @@ int32_t trace_open_pin_txt(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_reopen_pin_gz(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	gzfil[fndx] = gzopen(in_fnames[fndx], "r");
-	if (gzfil[fndx] == NULL) {
+	pc = parse_ctxs[fndx];
+	pc->gzfil = gzopen(in_fnames[fndx], "r");
+	if (pc->gzfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
@@ -232,9 +236,11 @@ int32_t trace_reopen_pin_gz(int16_t fndx) {
 //	The global list of gzipped file pointers is updated with the pointer to the open file
 //	returns 0 for error, 1 for success
 int32_t trace_reopen_pin_txt(int16_t fndx) {
+	parse_ctx	*pc;			//	parser context of this file
 	
-	txtfil[fndx] = fopen(in_fnames[fndx], "r");
-	if (txtfil[fndx] == NULL) {
+	pc = parse_ctxs[fndx];
+	pc->txtfil = fopen(in_fnames[fndx], "r");
+	if (pc->txtfil == NULL) {
 		printf("Error opening file '%s' for trace input.\n", in_fnames[fndx]);
 		return 0;
 	} else {
@@ -255,17 +261,18 @@ int32_t trace_reopen_pin_txt(int16_t fndx) {
 int32_t trace_read_pin_gz(int16_t fndx, memref *mr) {
 	//	see list of static/global variables as well as these local variables
 	char		*stat;				//	status response for gzgets and process_moola_nodata
-	crntfndx = fndx;				//	set for error messages to use
+	parse_ctx	*pc;				//	parser context of this file
+	pc = parse_ctxs[fndx];
 	while (1) {						//	loop until valid record or end-of-file
-		stat = gzgets(gzfil[fndx], ibfr, 160);		//	get next line of input from gzip input file
+		stat = gzgets(pc->gzfil, pc->ibfr, 160);		//	get next line of input from gzip input file
 		if (stat == NULL) {
 			//	end of file reached
 			return 0;
 		}
-		in_lineno[fndx]++;			//	increment line number
-		stat = process_pin_nodata(mr);
+		pc->lineno++;			//	increment line number
+		stat = process_pin_nodata(pc, mr);
 		if (stat) {					//	stat != 0 => valid input, otherwise get new line
-			mr->linenmbr = in_lineno[fndx];
+			mr->linenmbr = pc->lineno;
 			return 1;
 		}
 	}
@@ -283,17 +290,18 @@ int32_t trace_read_pin_gz(int16_t fndx, memref *mr) {
 int32_t trace_read_pin_txt(int16_t fndx, memref *mr) {
 	//	see list of static/global variables as well as these local variables
 	char		*stat;				//	status response for fgets and process_moola_nodata
-	crntfndx = fndx;				//	set for error messages to use
+	parse_ctx	*pc;				//	parser context of this file
+	pc = parse_ctxs[fndx];
 	while (1) {						//	loop until valid record or end-of-file
-		stat = fgets(ibfr, 160, txtfil[fndx]);		//	get next line of input from text input file
+		stat = fgets(pc->ibfr, 160, pc->txtfil);		//	get next line of input from text input file
 		if (stat == NULL) {
 			//	end of file reached
 			return 0;
 		}
-		in_lineno[fndx]++;			//	increment line number
-		stat = process_pin_nodata(mr);
+		pc->lineno++;			//	increment line number
+		stat = process_pin_nodata(pc, mr);
 		if (stat) {					//	stat != 0 => valid input, otherwise get new line
-			mr->linenmbr = in_lineno[fndx];
+			mr->linenmbr = pc->lineno;
 			return 1;
 		}
 	}
@@ -454,19 +462,21 @@ r_valid:
 */
 
 
-char *process_pin_nodata(memref *mr) {
-	cptr = ibfr;				//	set to first character in trace record
-	c = *cptr++;				//	get 1st char and point to next character
+char *process_pin_nodata(parse_ctx *pc, memref *mr) {
+	int32_t		mapit;			//	from input file, 0 - do not add offset, 1 - add offset to address
+	
+	pc->cptr = pc->ibfr;				//	set to first character in trace record
+	pc->c = *pc->cptr++;				//	get 1st char and point to next character
 	SKIP_WS						//	white space allowed at start of line (not expected though)
 
 	 //	get the thread ID
-	 get_dec_pin();				//	get a decimal value
-	 if (!cptr)	return NULL;	//	skip line if error in get_dec
+	 get_dec_pin(pc);				//	get a decimal value
+	 if (!pc->cptr)	return NULL;	//	skip line if error in get_dec
 	 // mr->pid = (int8_t) val;	//	save value as the processor ID field
 	SKIP_WS						//	skip space between PID and trace type
 
 	//	get the trace record type code (allow all codes - just because)
-	switch (c) {
+	switch (pc->c) {
 		case 'A':
 		case 'a':	mr->oper = XALLOC; break;
 		case 'F':
@@ -491,23 +501,23 @@ char *process_pin_nodata(memref *mr) {
 		default:
 			fprintf(stderr,
 					"Unexpected trace record type, '%c', at column %ld in file %s line %lld\n%s",
-					c, cptr - ibfr, in_fnames[crntfndx], in_lineno[crntfndx], ibfr);
+					pc->c, pc->cptr - pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->ibfr);
 			return NULL;
 	}
 	
-	c = *cptr++;				//	"consume" this character and go to next
+	pc->c = *pc->cptr++;				//	"consume" this character and go to next
 	//  get the hex address
-	get_hex_pin();
-	if (!cptr)	return NULL;	//	skip line if error in get_hex
-	mr->adrs = val;
+	get_hex_pin(pc);
+	if (!pc->cptr)	return NULL;	//	skip line if error in get_hex
+	mr->adrs = pc->val;
 	
 	if (mr->oper == XSTACK || mr->oper == XFREE) {
 		goto r_valid;
 	}
 	
 	//	get the decimal size
-	get_hex_pin();
-	if (!cptr)	return NULL;	//	skip line if error in get_dec
+	get_hex_pin(pc);
+	if (!pc->cptr)	return NULL;	//	skip line if error in get_dec
 	mr->size = 8; // (int32_t) val;
 	
 	//	get the decimal map flag
@@ -520,7 +530,7 @@ char *process_pin_nodata(memref *mr) {
 	if (mapit > 1) {
 		fprintf(stderr,
 				"Unexpected trace map value, '%d', at column %ld in file %s line %lld\n%s",
-				mapit, cptr - ibfr, in_fnames[crntfndx], in_lineno[crntfndx], ibfr);
+				mapit, pc->cptr - pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->ibfr);
 		return NULL;
 
 	}
@@ -548,16 +558,16 @@ char *process_pin_nodata(memref *mr) {
 	SKIP_WS						//	get character code of memory segment and make it 0-4
 								//	memory segment 0-4: global, heap, instruction, stack, other
 
-	if (c == 'H' || c == 'h') {
+	if (pc->c == 'H' || pc->c == 'h') {
 		mr->segmnt = HEAP;
-	} else if (c == 'S' || c == 's') {
+	} else if (pc->c == 'S' || pc->c == 's') {
 		mr->segmnt = STACK;
-	} else if (c == 'G' || c == 'g') {
+	} else if (pc->c == 'G' || pc->c == 'g') {
 		mr->segmnt = GLOBAL;
 	} else {
 		mr->segmnt = OTHER;
 	}
-	c = *cptr++;				//	"consume" this character and go to next
+	pc->c = *pc->cptr++;				//	"consume" this character and go to next
 	
 r_valid:
 	return 1;
@@ -567,18 +577,15 @@ r_valid:
 
 //  Various support functions used in the two process_moola_ functions:
 
-void get_dec_pin(void) {		//  get decimal value from input trace line
+void get_dec_pin(parse_ctx *pc) {		//  get decimal value from input trace line
 	SKIP_WS
-	val = 0;
-	if (!isdec[c]) {
+	pc->val = 0;
+	if (!isdec[pc->c]) {
 		fprintf(stderr, "ERROR:  expecting decimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-				cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-		cptr = NULL;		//  flag error
+				pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+		pc->cptr = NULL;		//  flag error
 	} else {
-		while (isdec[c]) {		//	first non-decimal character terminates the value
-			val = val * 10 + char_val[c];
-			c = *cptr++;
-		}
+		scan_dec(pc);				//	first non-decimal character terminates the value
 	}
 	return;
 }
@@ -586,54 +593,57 @@ void get_dec_pin(void) {		//  get decimal value from input trace line
 
 
 
-void get_hex_pin(void) {		//  get hexadecimal value from input trace line with required 0x lead
+void get_hex_pin(parse_ctx *pc) {		//  get hexadecimal value from input trace line with required 0x lead
 	SKIP_WS
-	c2 = *cptr++;
-	if (c != '0'  ||  c2 != 'x') {
+	pc->c2 = *pc->cptr++;
+	if (pc->c != '0'  ||  pc->c2 != 'x') {
 		fprintf(stderr, "ERROR:  expecting hexadecimal leading '0x' character %ld, file %s, line %lld found '%c%c'\n%s",
-				cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, c2, ibfr);
-		cptr = NULL;		//  flag error
+				pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->c2, pc->ibfr);
+		pc->cptr = NULL;		//  flag error
 	}
-	c = *cptr++;			//  get first char of hex value
-	val = 0;
-	if (!ishex[c]) {
+	pc->c = *pc->cptr++;			//  get first char of hex value
+	pc->val = 0;
+	if (!ishex[pc->c]) {
 		fprintf(stderr, "ERROR:  expecting hexadecimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-				cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-		cptr = NULL;		//  flag error
+				pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+		pc->cptr = NULL;		//  flag error
 	} else {
-		while (ishex[c]) {		//	first non-hex character terminates the value
-			val = val * 16 + char_val[c];
-			c = *cptr++;
-		}
+		scan_hex(pc);				//	first non-hex character terminates the value
 	}
 	return;
 }
 
 
-void get_hexbytes_pin(void) {	//  get hexadecimal value from input trace line as sequence of bytes
+void get_hexbytes_pin(parse_ctx *pc) {	//  get hexadecimal value from input trace line as sequence of bytes
 							//  val contains the just read size
-	for (bndx = 0; bndx < val; bndx++) {
-		bytes[bndx] = 0;
+	if (pc->val > 0) {
+		SKIP_WS
+		if (scan_hexbytes(pc)) {
+			return;					//	all of the bytes were converted at once
+		}
+	}
+	for (pc->bndx = 0; pc->bndx < pc->val; pc->bndx++) {
+		pc->bytes[pc->bndx] = 0;
 		SKIP_WS
 		//	special workaround for Gleipnir bug for 16-byte values
 		//if (val == 16) cptr += 6; //  skip bogus leading zeros
-		if (val == 16) cptr += 4; //  skip bogus leading zeros - skipping too many 1/14/2015 cfs
-		if (!ishex[c]) {
+		if (pc->val == 16) pc->cptr += 4; //  skip bogus leading zeros - skipping too many 1/14/2015 cfs
+		if (!ishex[pc->c]) {
 			fprintf(stderr, "ERROR:  expecting hexadecimal digit at character %ld, file %s, line %lld found '%c'\n%s",
-					cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
-			cptr = NULL;		//  flag error
+					pc->cptr-pc->ibfr, in_fnames[pc->fndx], pc->lineno, pc->c, pc->ibfr);
+			pc->cptr = NULL;		//  flag error
 			break;
 		} else {
-			bytes[bndx] = char_val[c];
-			c = *cptr++;
-			if (!ishex[c]) {
+			pc->bytes[pc->bndx] = char_val[pc->c];
+			pc->c = *pc->cptr++;
+			if (!ishex[pc->c]) {
 				//fprintf(stderr, "ERROR:  expecting hexadecimal digit at character %ld, file %s, line %lld found '%c'\n%s",
 				//		cptr-ibfr, in_fnames[crntfndx], in_lineno[crntfndx], c, ibfr);
 				//cptr = NULL;		//  flag error
 				break;
 			} else {
-				bytes[bndx] = bytes[bndx] * 16 + char_val[c];
-				c = *cptr++;
+				pc->bytes[pc->bndx] = pc->bytes[pc->bndx] * 16 + char_val[pc->c];
+				pc->c = *pc->cptr++;
 			}
 		}
 	}
@@ -0,0 +1,248 @@
+//
+//  trace_scan.c  (numeric field decoders for the text trace formats of Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__)  ||  defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+#include "moola.h"
+
+
+//	"trace_scan.c" converts the decimal, hexadecimal, and hex data byte fields of the text trace
+//	formats (trace_moola.c, trace_pin.c, trace_gleipnir.c).  The get_* functions of those files
+//	skip the white space, check the first character, and then call through the scan_* function
+//	pointers to convert the field.  On entry 'pc->c' holds the first character of the field and
+//	'pc->cptr' points to the character after it.  On return 'pc->val' (or pc->bytes) holds the
+//	value, 'pc->c' holds the first character after the field, and 'pc->cptr' points past it,
+//	exactly as the original one character at a time loops left them.
+//
+//	trace_scan_init selects the SSE4.2 versions when the processor supports them, otherwise the
+//	scalar versions stay in place.  The vector versions load the 16 characters starting at the
+//	field, find the first character that ends the field, and convert up to 16 digits at once.
+//	Longer fields are rare and are handed to the scalar versions.  The 16 byte loads may read
+//	past the end of the line, the parse_ctx input buffer is padded so they stay in the buffer.
+
+
+void	(*scan_dec)(parse_ctx *) = scan_dec_scalar;				//	decimal field decoder
+void	(*scan_hex)(parse_ctx *) = scan_hex_scalar;				//	hexadecimal field decoder
+int32_t	(*scan_hexbytes)(parse_ctx *) = scan_hexbytes_scalar;	//	hex data bytes decoder
+
+
+//  hex_digit	returns the value of hexadecimal digit 'c' or -1 if 'c' is not a hex digit
+static inline int32_t hex_digit(char c) {
+	if (c >= '0'  &&  c <= '9') {
+		return c - '0';
+	}
+	c |= 0x20;					//	fold upper case letters to lower case
+	if (c >= 'a'  &&  c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+
+
+//  scan_dec_scalar		convert the decimal field one character at a time
+void scan_dec_scalar(parse_ctx *pc) {
+	pc->val = 0;
+	while (pc->c >= '0'  &&  pc->c <= '9') {	//	first non-decimal character terminates the value
+		pc->val = pc->val * 10 + (pc->c - '0');
+		pc->c = *pc->cptr++;
+	}
+	return;
+}
+
+
+
+//  scan_hex_scalar		convert the hexadecimal field one character at a time
+void scan_hex_scalar(parse_ctx *pc) {
+	int32_t		d;				//	value of the current digit
+
+	pc->val = 0;
+	while ((d = hex_digit(pc->c)) >= 0) {		//	first non-hex character terminates the value
+		pc->val = pc->val * 16 + d;
+		pc->c = *pc->cptr++;
+	}
+	return;
+}
+
+
+
+//  scan_hexbytes_scalar	the byte by byte loops in the get_hexbytes functions are the scalar
+//	version, so this only tells the caller to use them
+//	returns 0, nothing has been converted
+int32_t scan_hexbytes_scalar(parse_ctx *pc) {
+	(void) pc;
+	return 0;
+}
+
+
+
+#ifdef SCAN_X86
+
+//	align_right[n] is the pshufb control that moves the first n characters of a vector to the
+//	last n lanes and zeros the leading lanes, so digit strings of any length line up on the
+//	least significant end of the vector
+static int8_t	align_right[17][16];
+
+
+//  scan_classify	returns the digit values of the 16 characters at 'q' in *dig and the
+//	bit mask of the characters that are not digits (not hex digits if 'hex' is set)
+__attribute__((target("sse4.2")))
+static inline uint32_t scan_classify(const char *q, int32_t hex, __m128i *dig) {
+	__m128i		v;				//	16 characters of the input line
+	__m128i		d;				//	characters offset from '0'
+	__m128i		isd;			//	lanes that are decimal digits
+	__m128i		l;				//	lower cased characters offset from 'a'
+	__m128i		isl;			//	lanes that are hex letters
+
+	v = _mm_loadu_si128((const __m128i *) q);
+	d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+	isd = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+	if (!hex) {
+		*dig = d;
+		return ~_mm_movemask_epi8(isd) & 0xffff;
+	}
+	l = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	isl = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+	*dig = _mm_blendv_epi8(_mm_add_epi8(l, _mm_set1_epi8(10)), d, isd);
+	return ~_mm_movemask_epi8(_mm_or_si128(isd, isl)) & 0xffff;
+}
+
+
+
+//  scan_dec_sse	convert a decimal field of up to 15 digits with SSE4.2
+__attribute__((target("sse4.2")))
+static void scan_dec_sse(parse_ctx *pc) {
+	const char	*q;				//	first character of the field
+	__m128i		dig;			//	digit values
+	__m128i		x;				//	combined digits
+	uint32_t	m;				//	mask of the non-digit characters
+	int32_t		n;				//	number of digits in the field
+
+	q = pc->cptr - 1;
+	m = scan_classify(q, 0, &dig);
+	if (m == 0) {
+		scan_dec_scalar(pc);	//	16 or more digits
+		return;
+	}
+	n = __builtin_ctz(m);
+	x = _mm_shuffle_epi8(dig, _mm_loadu_si128((const __m128i *) align_right[n]));
+	x = _mm_maddubs_epi16(x, _mm_set1_epi16(0x010a));			//	2 digit groups
+	x = _mm_madd_epi16(x, _mm_set1_epi32(0x00010064));			//	4 digit groups
+	x = _mm_packus_epi32(x, x);
+	x = _mm_madd_epi16(x, _mm_set1_epi32(0x00012710));			//	8 digit groups
+	pc->val = (int64_t) (uint32_t) _mm_cvtsi128_si32(x) * 100000000
+			+ (uint32_t) _mm_extract_epi32(x, 1);
+	pc->c = q[n];
+	pc->cptr = (char *) q + n + 1;
+	return;
+}
+
+
+
+//  scan_hex_sse	convert a hexadecimal field of up to 15 digits with SSE4.2
+__attribute__((target("sse4.2")))
+static void scan_hex_sse(parse_ctx *pc) {
+	const char	*q;				//	first character of the field
+	__m128i		dig;			//	digit values
+	__m128i		x;				//	combined digits
+	uint32_t	m;				//	mask of the non-hex characters
+	int32_t		n;				//	number of digits in the field
+
+	q = pc->cptr - 1;
+	m = scan_classify(q, 1, &dig);
+	if (m == 0) {
+		scan_hex_scalar(pc);	//	16 or more digits
+		return;
+	}
+	n = __builtin_ctz(m);
+	x = _mm_shuffle_epi8(dig, _mm_loadu_si128((const __m128i *) align_right[n]));
+	x = _mm_maddubs_epi16(x, _mm_set1_epi16(0x0110));			//	digit pairs to bytes
+	x = _mm_packus_epi16(x, x);									//	most significant byte first
+	pc->val = (int64_t) __builtin_bswap64((uint64_t) _mm_cvtsi128_si64(x));
+	pc->c = q[n];
+	pc->cptr = (char *) q + n + 1;
+	return;
+}
+
+
+
+//  scan_hexbytes_sse	convert the 'pc->val' data bytes with SSE4.2 when they are written as
+//	one unbroken string of 2 * pc->val hex digits of at most 16 characters
+//	returns 1 if the bytes were converted, 0 if the caller must convert them byte by byte
+__attribute__((target("sse4.2")))
+static int32_t scan_hexbytes_sse(parse_ctx *pc) {
+	const char	*q;				//	first character of the field
+	__m128i		dig;			//	digit values
+	__m128i		x;				//	combined digits
+	uint8_t		tmp[16];		//	converted bytes
+	uint32_t	m;				//	mask of the non-hex characters
+	int32_t		len;			//	number of characters for the bytes
+
+	if (pc->val <= 0  ||  pc->val > 8) {
+		return 0;
+	}
+	len = (int32_t) pc->val * 2;
+	q = pc->cptr - 1;
+	m = scan_classify(q, 1, &dig);
+	if (m & ((1u << len) - 1)) {
+		return 0;				//	separators or short bytes in the data
+	}
+	x = _mm_maddubs_epi16(dig, _mm_set1_epi16(0x0110));		//	digit pairs to bytes
+	x = _mm_packus_epi16(x, x);
+	_mm_storeu_si128((__m128i *) tmp, x);
+	memcpy(pc->bytes, tmp, pc->val);
+	pc->bndx = (int16_t) pc->val;
+	pc->c = q[len];
+	pc->cptr = (char *) q + len + 1;
+	return 1;
+}
+
+#endif
+
+
+
+//	trace_scan_init		select the field decoders for this processor.  Called once at startup.
+void trace_scan_init(void) {
+#ifdef SCAN_X86
+	int32_t		n, i;
+
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("sse4.2")) {
+		return;					//	keep the scalar decoders
+	}
+	for (n = 0; n <= 16; n++) {
+		for (i = 0; i < 16; i++) {
+			align_right[n][i] = (i >= 16 - n) ? i - (16 - n) : (int8_t) 0x80;
+		}
+	}
+	scan_dec = scan_dec_sse;
+	scan_hex = scan_hex_sse;
+	scan_hexbytes = scan_hexbytes_sse;
+#endif
+	return;
+}
@@ -0,0 +1,274 @@
+//
+//  trace_thread.c  (read-ahead trace input threads for Moola Multicore Cache Simulator)
+//  Copyright (c) 2013 Charles Shelor.
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//  Contact charles.shelor@gmail.com  or  Krishna.Kavi@unt.edu
+//  Net-Centric Software and Systems I/UCRC.  http://netcentric.unt.edu/content/welcome
+//
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "moola.h"
+
+
+//	"trace_thread.c" implements the '-read_ahead' option.  The trace access functions selected
+//	by '-informat' are wrapped so that each input file is decompressed and parsed by its own
+//	producer thread while the main thread runs the cache simulation.
+//
+//	The producer thread fills batches of memref records using the selected format's read
+//	function and hands them to the main thread through a bounded single-producer/single-
+//	consumer ring of batches.  The ring indices are the only shared state; the producer
+//	only writes 'head' and the consumer only writes 'tail', so no locks are needed for the
+//	hand-off.  trace_read_thread then copies one record per call out of the current batch,
+//	so the main loop in moola.c is unchanged.
+//
+//	The text format readers keep their parser state in a parse_ctx for each file, so the
+//	producer threads of different files decode in parallel without any locking.  The same
+//	wrappers are installed for multi-file '-multiexpand' runs so each file gets its own
+//	parsing thread even without '-read_ahead'.
+
+
+#define RA_BATCH 256			//	number of memref records in a batch
+#define RA_SLOTS 8				//	number of batches in each ring (must be a power of 2)
+#define RA_SPINS 64				//	number of sched_yield() spins before sleeping on an empty/full ring
+
+typedef struct ra_batch_rec {
+	int32_t		count;			//	number of valid records in this batch
+	int32_t		eof;			//	set when the end of the file follows the records of this batch
+	memref		recs[RA_BATCH];	//	the records of this batch
+} ra_batch;
+
+typedef struct ra_ring_rec {
+	ra_batch	*slots;			//	RA_SLOTS batches
+	pthread_t	thread;			//	producer thread for this file
+	atomic_uint	head;			//	number of batches published by the producer
+	atomic_uint	tail;			//	number of batches released by the consumer
+	atomic_int	stop;			//	set by the consumer to stop the producer
+	int32_t		pos;			//	consumer index of the next record in the batch at tail
+	int16_t		fndx;			//	index of the file in 'in_fnames'
+	int16_t		running;		//	set while the producer thread exists
+} ra_ring;
+
+
+//	The following variables are static to functions in this file
+static void		(*base_close)(int16_t);				//	close function of the selected format
+static int32_t	(*base_open)(int16_t);				//	open function of the selected format
+static int32_t	(*base_read)(int16_t, memref *);	//	read function of the selected format
+static int32_t	(*base_reopen)(int16_t);			//	reopen function of the selected format
+static ra_ring	*rings;								//	ring for each input file, 'in_filcnt' entries
+
+
+
+//	ra_wait		back off while the ring is empty or full
+//	'spins' counts the calls for this wait, the first RA_SPINS calls only yield the processor
+static void ra_wait(int32_t *spins) {
+	struct timespec	ts;			//	sleep time once spinning has not helped
+
+	if ((*spins)++ < RA_SPINS) {
+		sched_yield();
+	} else {
+		ts.tv_sec = 0;
+		ts.tv_nsec = 20000;
+		nanosleep(&ts, NULL);
+	}
+	return;
+}
+
+
+
+//	ra_producer		thread function that reads the file of ring 'arg' into batches
+static void *ra_producer(void *arg) {
+	ra_ring		*ring;			//	ring that this thread fills
+	ra_batch	*batch;			//	batch being filled
+	uint32_t	head;			//	local copy of the ring head
+	int32_t		spins;			//	back off count while the ring is full
+	int32_t		stat;			//	status from the format read function
+	int32_t		i;
+
+	ring = (ra_ring *) arg;
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	while (1) {
+		spins = 0;
+		while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= RA_SLOTS) {
+			if (atomic_load_explicit(&ring->stop, memory_order_relaxed)) {
+				return NULL;
+			}
+			ra_wait(&spins);
+		}
+		batch = &ring->slots[head & (RA_SLOTS - 1)];
+		batch->eof = 0;
+		for (i = 0; i < RA_BATCH; i++) {
+			memset(&batch->recs[i], 0, sizeof(memref));
+			stat = base_read(ring->fndx, &batch->recs[i]);
+			if (stat <= 0) {
+				batch->eof = 1;
+				break;
+			}
+		}
+		batch->count = i;
+		head++;
+		atomic_store_explicit(&ring->head, head, memory_order_release);
+		if (batch->eof  ||  atomic_load_explicit(&ring->stop, memory_order_relaxed)) {
+			return NULL;
+		}
+	}
+}
+
+
+
+//	ra_start	start the producer thread for file 'fndx' after the file has been opened
+//	returns 0 for error, 1 for success
+static int32_t ra_start(int16_t fndx) {
+	ra_ring		*ring;			//	ring for this file
+
+	ring = &rings[fndx];
+	if (ring->slots == NULL) {
+		ring->slots = malloc(RA_SLOTS * sizeof(ra_batch));
+		if (ring->slots == NULL) {
+			error("Unable to allocate memory for read-ahead batches", -10);
+		}
+	}
+	atomic_store(&ring->head, 0);
+	atomic_store(&ring->tail, 0);
+	atomic_store(&ring->stop, 0);
+	ring->pos = 0;
+	ring->fndx = fndx;
+	if (pthread_create(&ring->thread, NULL, ra_producer, ring) != 0) {
+		printf("Error starting read-ahead thread for file '%s'.\n", in_fnames[fndx]);
+		return 0;
+	}
+	ring->running = 1;
+	return 1;
+}
+
+
+
+//	ra_stop		stop and join the producer thread for file 'fndx'
+static void ra_stop(int16_t fndx) {
+	ra_ring		*ring;			//	ring for this file
+
+	ring = &rings[fndx];
+	if (ring->running) {
+		atomic_store(&ring->stop, 1);
+		pthread_join(ring->thread, NULL);
+		ring->running = 0;
+	}
+	return;
+}
+
+
+
+//	trace_thread_init	replace the trace access function pointers selected by '-informat'
+//	with the read-ahead versions in this file.  Called once after configuration.
+void trace_thread_init(void) {
+	rings = calloc(in_filcnt, sizeof(ra_ring));
+	if (rings == NULL) {
+		error("Unable to allocate memory for read-ahead rings", -10);
+	}
+	base_close = trace_close;
+	base_open = trace_open;
+	base_read = trace_read;
+	base_reopen = trace_reopen;
+	trace_close = trace_close_thread;
+	trace_open = trace_open_thread;
+	trace_read = trace_read_thread;
+	trace_reopen = trace_reopen_thread;
+	return;
+}
+
+
+
+//  function to close a read-ahead trace file
+//	the producer thread is stopped before the file is closed by the format close function
+void trace_close_thread(int16_t fndx) {
+	ra_stop(fndx);
+	base_close(fndx);
+	return;
+}
+
+
+
+//  function to open a read-ahead trace file
+//	the file is opened by the format open function and then its producer thread is started
+//	returns 0 for error, 1 for success
+int32_t trace_open_thread(int16_t fndx) {
+	if (base_open(fndx) == 0) {
+		return 0;
+	}
+	return ra_start(fndx);
+}
+
+
+
+//  function to reopen a read-ahead trace file
+//	returns 0 for error, 1 for success
+int32_t trace_reopen_thread(int16_t fndx) {
+	if (base_reopen(fndx) == 0) {
+		return 0;
+	}
+	return ra_start(fndx);
+}
+
+
+
+//  The trace_read_thread function copies the next record produced by the read-ahead thread
+//	of the file into the *mr record that was provided as an input.
+//  0 is returned if the end of file was reached, 1 is returned for a valid record
+
+int32_t trace_read_thread(int16_t fndx, memref *mr) {
+	ra_ring		*ring;			//	ring for this file
+	ra_batch	*batch;			//	batch at the ring tail
+	memref		*next;			//	idle list link of *mr, which the format readers never change
+	int64_t		time;			//	time of *mr, which the format readers never change
+	uint32_t	tail;			//	local copy of the ring tail
+	int32_t		spins;			//	back off count while the ring is empty
+
+	ring = &rings[fndx];
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	while (1) {
+		spins = 0;
+		while (atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+			if (!ring->running) {
+				return 0;			//	file closed or never opened
+			}
+			ra_wait(&spins);
+		}
+		batch = &ring->slots[tail & (RA_SLOTS - 1)];
+		if (ring->pos < batch->count) {
+			next = mr->next;
+			time = mr->time;
+			*mr = batch->recs[ring->pos++];
+			mr->next = next;
+			mr->time = time;
+			return 1;
+		}
+		if (batch->eof) {
+			return 0;				//	leave the eof batch at the tail so later reads also see eof
+		}
+		//	this batch is used up, release it to the producer
+		ring->pos = 0;
+		tail++;
+		atomic_store_explicit(&ring->tail, tail, memory_order_release);
+	}
+}
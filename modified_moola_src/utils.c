@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <execinfo.h>
 #include "moola.h"
 
@@ -74,6 +75,19 @@ void free_memref(memref *mr) {
 
 
 
+//	free_memrefs	puts the 'n' memref instances of 'mrs' on the memref free list
+void free_memrefs(memref **mrs, int32_t n) {
+	int32_t		i;
+	
+	for (i = n - 1; i >= 0; i--) {		//	reversed so mrs[0] is the next one handed out
+		mrs[i]->next = free_mrs;
+		free_mrs = mrs[i];
+	}
+	return;
+}
+
+
+
 //	get_bit		extracts a designated bit from an array of bytes
 //				The input array implements a bit array of size N by using a byte
 //				array of size N/8.  The bit index is divided by 8 to select a single
@@ -94,23 +108,46 @@ int8_t get_bit(int8_t *aray, int16_t bit) {
 
 
 
-//  This function gets a memref instance.  It first checks to see if there
-//	is a memref on the free list and returns from there.  If the free list
-//	is empty, malloc() is called to get memory to make a new memref and that
-//	is then returned.
-memref *get_memref() {
+//	memref instances are carved from slabs of MR_SLAB records.  A new slab is allocated only
+//	when the free list and the current slab are both empty, so after the queues reach their
+//	working size the free list supplies every request and no memory is allocated.
+#define MR_SLAB 4096			//	number of memref records in a slab
+
+static memref	*slab_next;		//	next unused record of the current slab
+static memref	*slab_end;		//	end of the current slab
+
+
+
+//  mr_alloc	takes a memref from the free list, or from the current slab when the free list
+//	is empty.  None of the fields are initialized.
+static inline memref *mr_alloc(void) {
 	memref		*mr;			//	pointer to record that will be returned
-	int16_t		i;
 	
-	if (free_mrs == NULL) {
-		mr = malloc(sizeof(memref));
-		if (mr == NULL) {
-			error("Unable to allocate memory for 'get_memref' request", -10);
-		}
-	} else {
+	if (free_mrs != NULL) {
 		mr = free_mrs;
 		free_mrs = mr->next;
+		return mr;
 	}
+	if (slab_next == slab_end) {
+		slab_next = aligned_alloc(64, MR_SLAB * sizeof(memref));
+		if (slab_next == NULL) {
+			error("Unable to allocate memory for 'get_memref' request", -10);
+		}
+		slab_end = slab_next + MR_SLAB;
+	}
+	return slab_next++;
+}
+
+
+
+//  This function gets a memref instance.  It first checks to see if there
+//	is a memref on the free list and returns from there.  If the free list
+//	is empty, a new memref is taken from the current slab.  The record
+//	fields are cleared.
+memref *get_memref() {
+	memref		*mr;			//	pointer to record that will be returned
+	
+	mr = mr_alloc();
 	//	if (mr == (void *) 0x0100106e60) {
 	//		printf("mr 0x0100106e60 gotten\n");
 	//	}
@@ -119,19 +156,43 @@ memref *get_memref() {
 	mr->next = 0;
 	mr->oper = 0;
 	mr->pid = 0;
-	mr->prev = 0;
 	mr->segmnt = 0;
 	mr->size = 0;
 	mr->split = 0;
 	mr->time = 0;
-	for (i = 0; i < MAX_MR_DATA; i++) {
-		mr->data[i] = 0;
-	}
+#ifdef DATAVALS
+	memset(mr->data, 0, MAX_MR_DATA);
+#endif
+	return mr;
+}
+
+
+
+//  get_memref_raw	gets a memref instance without clearing it, for callers that
+//	overwrite every field.  Only the idle list link is cleared.
+memref *get_memref_raw() {
+	memref		*mr;			//	pointer to record that will be returned
+	
+	mr = mr_alloc();
+	mr->next = 0;
 	return mr;
 }
 
 
 
+//  get_memrefs		gets 'n' memref instances into 'mrs' without clearing them, see get_memref_raw
+void get_memrefs(memref **mrs, int32_t n) {
+	int32_t		i;
+	
+	for (i = 0; i < n; i++) {
+		mrs[i] = mr_alloc();
+		mrs[i]->next = 0;
+	}
+	return;
+}
+
+
+
 //	halloc		This function tracks heap addresses that have been allocated
 void halloc(memref *mr){
 	return;
@@ -234,15 +295,19 @@ void		print_cache(cache *cash) {
 	//  TBD:  repeat for capacity, compulsory, conflict, coherency
 	//	TBD:  should these be split into segments?
 	
-	printf("\nMem Seg  Resolution     Read           Untouch              Live");
-	printf("           Useless             Dusty              Dead             Mixed\n");
-	for (seg = 0; seg < 5; seg++) {
-		for (res = 0; res < 4; res++) {
-			printf("%s   %s", seg_str[seg], res_str[res]);
-			for (typ = 0; typ < 7; typ++) {
-				printf("%16s  ", int64_to_str(cash->cntrs[seg][res][typ], bfr1));
+	if (tags_only) {
+		printf("\nByte usage counters are not collected with -tags_only\n");
+	} else {
+		printf("\nMem Seg  Resolution     Read           Untouch              Live");
+		printf("           Useless             Dusty              Dead             Mixed\n");
+		for (seg = 0; seg < 5; seg++) {
+			for (res = 0; res < 4; res++) {
+				printf("%s   %s", seg_str[seg], res_str[res]);
+				for (typ = 0; typ < 7; typ++) {
+					printf("%16s  ", int64_to_str(cash->cntrs[seg][res][typ], bfr1));
+				}
+				printf("\n");
 			}
-			printf("\n");
 		}
 	}
 	
@@ -306,7 +371,13 @@ void	print_mr(memref *mr) {
 					printf(" ");
 				}
 			}
-			printf(" %c\n", seg_code[mr->segmnt]);
+			printf(" %c", seg_code[mr->segmnt]);
+#ifdef GLEIPNIR
+			if (strncmp(in_format, "gleipnir", 8) == 0  &&  mr->fname_id != SYM_NONE) {
+				printf(" %s %s %s", symbol_name(mr->fname_id), mr->scope, symbol_name(mr->vname_id));
+			}
+#endif
+			printf("\n");
 			break;
 			
 		case MRINSTR:
@@ -337,20 +408,17 @@ void	print_mr(memref *mr) {
 
 
 
-//			print_set	prints one cache-line set from MRU to LRU, giving adrs and pointers
+//			print_set	prints one cache-line set from MRU to LRU, giving adrs, way and rank
 void		print_set(cacheset *set) {
 	cacheline	*cl;			//	pointer to cacheline to print
 	int32_t		nmbr_lines;		//	number of lines in the set
 	int32_t		n;				//	loop index for the lines
 	
 	nmbr_lines = set->owner->assoc;
-	printf("set MRU line:  %03x, tag %10llx\n", (uint16_t) set->mru & 0xfff, set->mru->adrs);
-	printf("set LRU line:  %03x, tag %10llx\n", (uint16_t) set->lru & 0xfff, set->lru->adrs);
-	cl = set->mru;
 	for (n = 0; n < nmbr_lines; n++) {
-		printf("line memory:   %03x, tag %10llx,  mru %03x,  lru %03x\n", (uint16_t) cl & 0xfff,
-			   cl->adrs, (uint16_t) cl->mru & 0xfff, (uint16_t) cl->lru & 0xfff);
-		cl = cl->lru;
+		cl = rank_find(set, n);
+		printf("line memory:   %03x, tag %10llx,  way %2d,  rank %2d\n", (uint16_t) cl & 0xfff,
+			   cl->adrs, (int32_t) (cl - set->ways), n);
 		fflush(stdout);
 	}
 	printf("\n");
@@ -392,22 +460,48 @@ void put_bit(int8_t val, int8_t *aray, int16_t bit) {
 
 
 
+//	This function sets up the empty queue of processor 'pid' with a ring of at
+//	least 'size' entries
+void	queue_init(int16_t pid, int32_t size) {
+	uint32_t	nmbr;		//	ring size, a power of 2
+	
+	for (nmbr = 64; nmbr < (uint32_t) size; nmbr *= 2);
+	queues[pid].ring = malloc(nmbr * sizeof(memref *));
+	if (queues[pid].ring == NULL) {
+		error("Unable to allocate memory for processor queue", -10);
+	}
+	queues[pid].head = 0;
+	queues[pid].tail = 0;
+	queues[pid].mask = nmbr - 1;
+	queues[pid].count = 0;
+}
+
+
+
 //	This function accepts a processor ID and a memref pointer and then adds
 //	the memref item to the appropriate processor queue
 void	queue_add(int16_t pid, memref *mr) {
-	if (queues[pid].count == 0) {			//	queue currently empty
-		queues[pid].count = 1;				//	initialize item count
-		queues[pid].newest = mr;			//	both newest and oldest are this item
-		queues[pid].oldest = mr;
-		mr->next = NULL;					//	forward link of item being added
-		mr->prev = NULL;					//	backward link of item being added
-	} else {
-		queues[pid].count++;				//	increment item count
-		mr->next = queues[pid].newest;		//	forward link of item being added
-		mr->prev = NULL;					//	backward link of item being added
-		queues[pid].newest->prev = mr;		//	backward link of current newest
-		queues[pid].newest = mr;			//	item being added is now newest
+	mr_queue	*q;			//	queue of this processor
+	memref		**ring;		//	doubled ring when the queue is full
+	uint32_t	i;
+	
+	q = &queues[pid];
+	if ((uint32_t) q->count > q->mask) {	//	queue full, double the ring keeping the order
+		ring = malloc(2 * (q->mask + 1) * sizeof(memref *));
+		if (ring == NULL) {
+			error("Unable to allocate memory for processor queue", -10);
+		}
+		for (i = 0; i < (uint32_t) q->count; i++) {
+			ring[i] = q->ring[(q->tail + i) & q->mask];
+		}
+		free(q->ring);
+		q->ring = ring;
+		q->tail = 0;
+		q->head = q->count;
+		q->mask = 2 * q->mask + 1;
 	}
+	q->ring[q->head++ & q->mask] = mr;		//	item being added is now newest
+	q->count++;								//	increment item count
 }
 
 
@@ -415,23 +509,15 @@ void	queue_add(int16_t pid, memref *mr) {
 //	This function accepts a processor ID and removes the oldest memref item for
 //	that processor and returns its pointer.  It returns NULL if the queue is empty
 memref	*queue_take(int16_t pid) {
-	memref		*mr;		//	pointer to return
-	if (queues[pid].count == 0) {
+	mr_queue	*q;			//	queue of this processor
+	
+	q = &queues[pid];
+	if (q->count == 0) {
 		error("queue_take called when selected queue was empty", -11);
-		mr = NULL;
-	} else {
-		mr = queues[pid].oldest;			//	get oldest queue item
-		if (queues[pid].count == 1) {		//	special needs for single element
-			queues[pid].count = 0;			//	indicate empty queue
-			queues[pid].newest = NULL;		//	newest item is NULL
-			queues[pid].oldest = NULL;		//	oldest item is NULL
-		} else {
-			queues[pid].count--;			//	decrement item count
-			queues[pid].oldest = mr->prev;	//	oldest now points to previous
-			mr->prev->next = NULL;			//	mark previous as new end of list			
-		}
+		return NULL;
 	}
-	return mr;
+	q->count--;								//	decrement item count
+	return q->ring[q->tail++ & q->mask];	//	oldest queue item
 }
 
 
@@ -455,4 +541,66 @@ void set_bit(int8_t *aray, int16_t bit) {
 
 
 
+//	The dispatch loop in moola.c processes the queue whose oldest entry has the earliest time
+//	next, the lowest processor ID winning ties.  sched_tree is a tournament tree over the
+//	queues that keeps that processor at its root.  The leaves are nodes sched_leaves through
+//	2 * sched_leaves - 1, one for each processor; each internal node holds the winner of its
+//	two children.  A change to the oldest entry of one queue replays only the matches on the
+//	path from its leaf to the root.
+static int16_t	sched_tree[2 * MAX_PIDS];	//	winning processor of each node
+static int64_t	sched_key[MAX_PIDS];		//	time of the oldest entry of each queue, INT64_MAX => empty
+static int16_t	sched_leaves;				//	number of leaves, a power of 2 >= nmbr_cores
+
+
 
+//	sched_match		returns the winner of processors 'a' and 'b'
+static inline int16_t sched_match(int16_t a, int16_t b) {
+	if (sched_key[b] < sched_key[a]  ||  (sched_key[b] == sched_key[a]  &&  b < a)) {
+		return b;
+	}
+	return a;
+}
+
+
+
+//	sched_build		rebuilds the tournament tree from the current queue contents
+void	sched_build(void) {
+	int16_t		p;
+	int16_t		n;			//	tree node index
+	
+	for (sched_leaves = 1; sched_leaves < nmbr_cores; sched_leaves *= 2);
+	for (p = 0; p < sched_leaves; p++) {
+		sched_key[p] = (p < nmbr_cores  &&  queues[p].count != 0) ? QUEUE_OLDEST(&queues[p])->time : INT64_MAX;
+		sched_tree[sched_leaves + p] = p;
+	}
+	for (n = sched_leaves - 1; n >= 1; n--) {
+		sched_tree[n] = sched_match(sched_tree[2 * n], sched_tree[2 * n + 1]);
+	}
+}
+
+
+
+//	sched_update	replays the matches of processor 'pid' after its queue has changed
+void	sched_update(int16_t pid) {
+	int16_t		n;			//	tree node index
+	
+	sched_key[pid] = (queues[pid].count != 0) ? QUEUE_OLDEST(&queues[pid])->time : INT64_MAX;
+	for (n = (sched_leaves + pid) / 2; n >= 1; n /= 2) {
+		sched_tree[n] = sched_match(sched_tree[2 * n], sched_tree[2 * n + 1]);
+	}
+}
+
+
+
+//	sched_min	returns the processor whose queue has the earliest oldest entry, or -1 if all
+//	the queues are empty.  The time of that entry is returned in *time.
+int16_t	sched_min(int64_t *time) {
+	int16_t		p;
+	
+	p = sched_tree[1];
+	if (sched_key[p] == INT64_MAX) {
+		return -1;
+	}
+	*time = sched_key[p];
+	return p;
+}